@@ -0,0 +1,415 @@
+/*!
+    Author: Robert Crocombe
+    Class: CS452 Operating Systems Spring 2005
+
+    Phase 1 microbenchmarks: "make bench" builds this like a testcase,
+    and "make bench.csv" runs it under each scheduling class.
+
+    fork_join   fork1() of a child that quits at once, then join()
+    ctx_switch  one dispatcher() call among spinning processes of
+                equal priority (with one spinner, the dispatcher
+                picks the same process again, so that's all it costs)
+    ping_pong   unblock_proc() of a blocked higher priority process,
+                which runs, block_me()s again and lets us back in
+    zap_fanout  from unblock_proc() of a zapped process, which quits,
+                until the last of its zappers is running again
+    wake        unblock_proc() of one of a crowd of blocked lower
+                priority sleepers: off the wait list and onto the ready
+                list, and the dispatcher keeps us
+    sleep       per sleeper, from join() on a sweeper at their priority
+                until it's seen them all block again: each sleeper
+                comes off the ready list, runs and block_me()s back
+                onto the wait list (at the low loads, the join and the
+                sweeper are a good part of it)
+
+    Each is run at 1, 10 and MAXPROC - 1 live processes (not counting
+    the sentinel).  start1 and the driver running the benchmarks count,
+    and the rest that aren't part of the benchmark itself are sitting
+    in block_me(), so there is always a minimum: the 'live' column has
+    the real number.
+
+    sys_clock() only counts microseconds, so operations are timed in
+    batches of BATCH and each sample is the batch's time / BATCH.  A
+    zap fan-out takes long enough to be a sample on its own.
+
+    Output is CSV on stdout, one line per benchmark and load, times in
+    ns per operation.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <usloss.h>
+#include <phase1.h>
+
+#define SAMPLES 200
+#define BATCH   50
+
+/* 1 is the highest priority.  Everything forked at a higher priority
+ * than the driver runs as soon as it's forked. */
+#define TARGET_PRIORITY     1
+#define WORKER_PRIORITY     2
+#define IDLE_PRIORITY       3
+#define DRIVER_PRIORITY     4
+#define SPINNER_PRIORITY    5
+#define SLEEPER_PRIORITY    5
+
+/* block_me() codes: above MIN_BLOCK_CODE, below phase 1's own */
+#define BLOCK_IDLE   11
+#define BLOCK_PONG   12
+#define BLOCK_TARGET 13
+#define BLOCK_SLEEP  14
+
+/* start1 and the driver */
+#define BASE_LIVE 2
+
+static const int loads[] = { 1, 10, MAXPROC - 1 };
+#define NUM_LOADS (sizeof(loads) / sizeof(loads[0]))
+
+static int samples[SAMPLES];
+static const char *sched_name;
+
+static int idle_pids[MAXPROC];
+static int idle_count;
+
+static volatile int spinning;
+static int spinners;
+
+static volatile int ponging;
+static int ponger_pid;
+
+static int target_pid;
+static volatile int last_zapper_back;
+
+static volatile int sleeping;
+static volatile int sleeps;
+static int sleeps_wanted;
+static int sleeper_pids[MAXPROC];
+
+static int
+compare_ints(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+static int
+percentile(int pct)
+{
+    return samples[(pct * (SAMPLES - 1)) / 100];
+}
+
+static void
+report(const char *bench, int live, int ops_per_sample)
+{
+    qsort(samples, SAMPLES, sizeof(int), compare_ints);
+
+    printf("%s,%s,%d,%d,%d,%d,%d,%d,%d,%d\n",
+           sched_name, bench, live, SAMPLES, ops_per_sample,
+           samples[0], percentile(50), percentile(90), percentile(99),
+           samples[SAMPLES - 1]);
+}
+
+/*!
+    Processes that are just there to be live: they block until
+    stop_idle().
+*/
+
+static int
+idle(char *arg)
+{
+    block_me(BLOCK_IDLE);
+    return 0;
+}
+
+static void
+start_idle(int count)
+{
+    for (idle_count = 0; idle_count < count; ++idle_count)
+        idle_pids[idle_count] = fork1("idle", idle, NULL, USLOSS_MIN_STACK,
+                                      IDLE_PRIORITY);
+}
+
+static void
+stop_idle(void)
+{
+    int status;
+    int i = 0;
+
+    for ( ; i < idle_count; ++i)
+    {
+        unblock_proc(idle_pids[i]);
+        join(&status);
+    }
+    idle_count = 0;
+}
+
+static int
+child(char *arg)
+{
+    return 0;
+}
+
+static void
+bench_fork_join(int load)
+{
+    int extra = load - BASE_LIVE - 1;
+    int i, j, t0, status;
+
+    start_idle(extra > 0 ? extra : 0);
+
+    for (i = 0; i < SAMPLES; ++i)
+    {
+        t0 = sys_clock();
+        for (j = 0; j < BATCH; ++j)
+        {
+            fork1("child", child, NULL, USLOSS_MIN_STACK, WORKER_PRIORITY);
+            join(&status);
+        }
+        samples[i] = (sys_clock() - t0) * 1000 / BATCH;
+    }
+
+    report("fork_join", BASE_LIVE + 1 + idle_count, BATCH);
+    stop_idle();
+}
+
+/*!
+    The first spinner forked keeps time; the others just go around with
+    it until it's done.
+*/
+
+static int
+spinner(char *arg)
+{
+    int i, j, t0;
+
+    if (strcmp(arg, "timer"))
+    {
+        while (spinning)
+            dispatcher();
+        return 0;
+    }
+
+    for (i = 0; i < SAMPLES; ++i)
+    {
+        t0 = sys_clock();
+        for (j = 0; j < BATCH; ++j)
+            dispatcher();
+        samples[i] = (sys_clock() - t0) * 1000 / (BATCH * spinners);
+    }
+
+    spinning = 0;
+    return 0;
+}
+
+static void
+bench_ctx_switch(int load)
+{
+    int i, status;
+
+    spinners = load - BASE_LIVE;
+    if (spinners < 1)
+        spinners = 1;
+
+    /* Spinners are below the driver, so none of them start until the
+     * driver blocks in join() with all of them ready. */
+    spinning = 1;
+    fork1("spinner", spinner, "timer", USLOSS_MIN_STACK, SPINNER_PRIORITY);
+    for (i = 1; i < spinners; ++i)
+        fork1("spinner", spinner, "", USLOSS_MIN_STACK, SPINNER_PRIORITY);
+
+    for (i = 0; i < spinners; ++i)
+        join(&status);
+
+    report("ctx_switch", BASE_LIVE + spinners, spinners * BATCH);
+}
+
+static int
+ponger(char *arg)
+{
+    while (ponging)
+        block_me(BLOCK_PONG);
+    return 0;
+}
+
+static void
+bench_ping_pong(int load)
+{
+    int extra = load - BASE_LIVE - 1;
+    int i, j, t0, status;
+
+    start_idle(extra > 0 ? extra : 0);
+
+    ponging = 1;
+    ponger_pid = fork1("ponger", ponger, NULL, USLOSS_MIN_STACK,
+                       TARGET_PRIORITY);
+
+    for (i = 0; i < SAMPLES; ++i)
+    {
+        t0 = sys_clock();
+        for (j = 0; j < BATCH; ++j)
+            unblock_proc(ponger_pid);
+        samples[i] = (sys_clock() - t0) * 1000 / BATCH;
+    }
+
+    ponging = 0;
+    unblock_proc(ponger_pid);
+    join(&status);
+
+    report("ping_pong", BASE_LIVE + 1 + idle_count, BATCH);
+    stop_idle();
+}
+
+static int
+target(char *arg)
+{
+    block_me(BLOCK_TARGET);
+    return 0;
+}
+
+static int
+zapper(char *arg)
+{
+    zap(target_pid);
+    last_zapper_back = sys_clock();
+    return 0;
+}
+
+static void
+bench_zap_fanout(int load)
+{
+    int zappers = load - BASE_LIVE - 1;
+    int i, j, t0, status;
+
+    if (zappers < 1)
+        zappers = 1;
+
+    for (i = 0; i < SAMPLES; ++i)
+    {
+        /* The target blocks, and the zappers block zapping it, as
+         * soon as they're forked. */
+        target_pid = fork1("target", target, NULL, USLOSS_MIN_STACK,
+                           TARGET_PRIORITY);
+        for (j = 0; j < zappers; ++j)
+            fork1("zapper", zapper, NULL, USLOSS_MIN_STACK, WORKER_PRIORITY);
+
+        /* All of them outrank us, so they're all done when we're back */
+        t0 = sys_clock();
+        unblock_proc(target_pid);
+        samples[i] = (last_zapper_back - t0) * 1000;
+
+        for (j = 0; j <= zappers; ++j)
+            join(&status);
+    }
+
+    report("zap_fanout", BASE_LIVE + 1 + zappers, 1);
+}
+
+static int
+sleeper(char *arg)
+{
+    while (sleeping)
+    {
+        ++sleeps;
+        block_me(BLOCK_SLEEP);
+    }
+    return 0;
+}
+
+/*!
+    At the sleepers' priority, so it only gets to run between them: the
+    dispatcher() lets the rest go until they've all blocked again.
+*/
+
+static int
+sweeper(char *arg)
+{
+    while (sleeps < sleeps_wanted)
+        dispatcher();
+    return 0;
+}
+
+/*!
+    Let all 'sleepers' run and block again.  Returns how long that took.
+*/
+
+static int
+sweep(int sleepers)
+{
+    int t0, status;
+
+    sleeps_wanted = sleeps + sleepers;
+    fork1("sweeper", sweeper, NULL, USLOSS_MIN_STACK, SLEEPER_PRIORITY);
+    t0 = sys_clock();
+    join(&status);
+    return sys_clock() - t0;
+}
+
+static void
+bench_wake_sleep(int load)
+{
+    int sleepers = load - BASE_LIVE - 1;
+    int sleep_samples[SAMPLES];
+    int i, j, t0, status;
+
+    if (sleepers < 1)
+        sleepers = 1;
+
+    sleeping = 1;
+    for (i = 0; i < sleepers; ++i)
+        sleeper_pids[i] = fork1("sleeper", sleeper, NULL, USLOSS_MIN_STACK,
+                                SLEEPER_PRIORITY);
+    sweep(sleepers);
+
+    for (i = 0; i < SAMPLES; ++i)
+    {
+        t0 = sys_clock();
+        for (j = 0; j < sleepers; ++j)
+            unblock_proc(sleeper_pids[j]);
+        samples[i] = (sys_clock() - t0) * 1000 / sleepers;
+        sleep_samples[i] = sweep(sleepers) * 1000 / sleepers;
+    }
+    report("wake", BASE_LIVE + sleepers, sleepers);
+
+    memcpy(samples, sleep_samples, sizeof(samples));
+    report("sleep", BASE_LIVE + sleepers, sleepers);
+
+    sleeping = 0;
+    for (i = 0; i < sleepers; ++i)
+        unblock_proc(sleeper_pids[i]);
+    for (i = 0; i < sleepers; ++i)
+        join(&status);
+}
+
+static int
+driver(char *arg)
+{
+    unsigned int i = 0;
+
+    printf("sched,bench,live,samples,ops_per_sample,"
+           "min_ns,p50_ns,p90_ns,p99_ns,max_ns\n");
+
+    for ( ; i < NUM_LOADS; ++i)
+    {
+        bench_fork_join(loads[i]);
+        bench_ctx_switch(loads[i]);
+        bench_ping_pong(loads[i]);
+        bench_zap_fanout(loads[i]);
+        bench_wake_sleep(loads[i]);
+    }
+
+    return 0;
+}
+
+int
+start1(char *arg)
+{
+    int status;
+
+    sched_name = getenv("PHASE1_SCHED");
+    if (!sched_name)
+        sched_name = "fixed";
+
+    fork1("driver", driver, NULL, 4 * USLOSS_MIN_STACK, DRIVER_PRIORITY);
+    join(&status);
+    return 0;
+}
@@ -0,0 +1,243 @@
+/*!
+    Author: Robert Crocombe
+    Class: CS452 Operating Systems Spring 2005
+
+    Priority inheritance and deadlock detection.  A process about to
+    block on something another process holds (a mutex mailbox, say, or
+    a zappee it's waiting to quit) can lend its priority to the holder
+    for as long as it's blocked.  The holder runs at the best of its own priority
+    and those of everyone lending to it, and if it's blocked lending to
+    somebody else in turn, that goes down the chain too.
+
+    'own_priority' is the priority the scheduler gave a process (fork1,
+    and MLFQ moves it around); 'priority' is what it actually runs at.
+    They're the same unless somebody is lending.
+
+    Loans are paid back as soon as the lender is unblocked, whoever
+    does the unblocking: unblock_proc(), quit() for a joined parent,
+    or unblock_zappers().  A holder that quits with lenders still
+    blocked on it just drops them.
+
+    The loans are also a wait-for graph.  Each blocked process waits on
+    at most one holder, so when a new loan is made, following 'lent_to'
+    from the holder either runs out or comes back around to the lender:
+    a deadlock.  That walk is as long as the chain, which is what
+    update_priority() walks anyway.  The cycle gets reported (pids,
+    names and what each is waiting on) when it closes; nothing is done
+    about it, since zapping one of them may still break it.
+
+    Only mailbox loans change priorities unless PHASE1_INHERIT is "all":
+    the required tests expect a parent blocked in join() or zap() to
+    leave its children's schedule alone.  Zaps and joins are in the
+    wait-for graph either way.
+
+    Only waits with a single, known holder are in the graph: zaps, joins
+    on an only child, and sends on MboxInherit() mailboxes (mutexes and
+    semaphores).  Receivers, and joins with several live children, could
+    be satisfied by any of a number of processes, so a cycle through
+    them isn't necessarily a deadlock.
+
+    Callers have interrupts disabled.
+*/
+
+#include "utility.h"
+#include "scheduler.h"
+#include "inherit.h"
+
+#include <stdlib.h>         /* getenv */
+#include <string.h>         /* strcmp */
+
+/* Cycles reported so far */
+unsigned int deadlocks_found = 0;
+
+/* Do zaps and joins lend priority too, or just mailboxes? */
+static int inherit_all_waits = 0;
+
+/*!
+    Pick which waits lend priority.  Called from startup().
+*/
+
+void
+inherit_init(void)
+{
+    const char *which = getenv("PHASE1_INHERIT");
+
+    if (!which || !strcmp(which, "mbox"))
+        inherit_all_waits = 0;
+    else if (!strcmp(which, "all"))
+        inherit_all_waits = 1;
+    else
+        KERNEL_ERROR("Unknown PHASE1_INHERIT setting '%s'", which);
+}
+
+static const char *
+wait_kind_to_string(int kind)
+{
+    switch (kind)
+    {
+    case WAIT_ZAP:  return "zap of pid";
+    case WAIT_JOIN: return "join on pid";
+    case WAIT_MBOX: return "mailbox";
+    default:        return "nothing";
+    }
+}
+
+/*!
+    'donor' just closed a loop of loans.  Say who's in it.
+*/
+
+static void
+report_cycle(proc_struct *donor)
+{
+    proc_struct *p = donor;
+    int length = 0;
+
+    do {
+        ++length;
+        p = p->lent_to;
+    } while (p != donor);
+
+    ++deadlocks_found;
+    console("deadlock: %d processes waiting on each other:\n", length);
+
+    do {
+        console("    pid %d '%s' waits for pid %d '%s': %s %d\n",
+                p->pid, proc_name(p), p->lent_to->pid, proc_name(p->lent_to),
+                wait_kind_to_string(proc_wait_kind(p)), proc_wait_id(p));
+        p = p->lent_to;
+    } while (p != donor);
+}
+
+/*!
+    Returns 1 if following loans from 'donor' comes back to it.
+*/
+
+static int
+closes_cycle(proc_struct *donor)
+{
+    proc_struct *p = donor->lent_to;
+    int steps = 0;
+
+    while (p && (p != donor) && (steps < MAXPROC))
+    {
+        p = p->lent_to;
+        ++steps;
+    }
+    return p == donor;
+}
+
+/*!
+    Recompute what 'p' runs at, and if that changes, whom 'p' is
+    lending to as well, and so on.  Gives up after MAXPROC steps so
+    that a cycle of lenders (a deadlock, but not ours to report) can't
+    hang us.
+*/
+
+void
+update_priority(proc_struct *p)
+{
+    int steps = 0;
+    int best;
+    proc_struct *d;
+
+    for ( ; p && (steps < MAXPROC); p = p->lent_to, ++steps)
+    {
+        best = p->own_priority;
+        for (d = p->donors; d; d = d->next_donor)
+            if (   (d->priority < best)
+                && (inherit_all_waits || (proc_wait_kind(d) == WAIT_MBOX)))
+                best = d->priority;
+
+        if (best == p->priority)
+            return;
+
+        DP(DEBUG2, "'%s' pid %d now at priority %d (own %d)\n",
+                   proc_name(p), p->pid, best, p->own_priority);
+        set_priority(p, best);
+    }
+}
+
+/*!
+    'donor' lends its priority to 'holder' until reclaim(), because it
+    is waiting on 'holder' for 'kind' 'id'.  Any loan 'donor' already
+    had out is paid back first.
+*/
+
+void
+lend(proc_struct *donor, proc_struct *holder, int kind, int id)
+{
+    reclaim(donor);
+
+    if (!holder || (holder == donor))
+        return;
+
+    DP(DEBUG2, "'%s' pid %d lending priority %d to '%s' pid %d\n",
+               proc_name(donor), donor->pid, donor->priority,
+               proc_name(holder), holder->pid);
+
+    donor->lent_to = holder;
+    donor->next_donor = holder->donors;
+    holder->donors = donor;
+    proc_wait_kind(donor) = kind;
+    proc_wait_id(donor) = id;
+
+    if (closes_cycle(donor))
+        report_cycle(donor);
+
+    update_priority(holder);
+}
+
+/*!
+    Pay back whatever 'donor' lent out, if anything.
+*/
+
+void
+reclaim(proc_struct *donor)
+{
+    proc_struct *holder = donor->lent_to;
+    proc_struct **link;
+
+    if (!holder)
+        return;
+
+    for (link = &holder->donors; *link; link = &(*link)->next_donor)
+    {
+        if (*link == donor)
+        {
+            *link = donor->next_donor;
+            break;
+        }
+    }
+
+    donor->lent_to = NULL;
+    donor->next_donor = NULL;
+    proc_wait_kind(donor) = WAIT_NOTHING;
+    proc_wait_id(donor) = 0;
+
+    DP(DEBUG2, "'%s' pid %d reclaimed priority from '%s' pid %d\n",
+               proc_name(donor), donor->pid, proc_name(holder), holder->pid);
+
+    update_priority(holder);
+}
+
+/*!
+    'holder' is quitting: whoever is still lending to it stops.
+*/
+
+void
+release_donors(proc_struct *holder)
+{
+    proc_struct *d = holder->donors;
+    proc_struct *next;
+
+    while (d)
+    {
+        next = d->next_donor;
+        d->lent_to = NULL;
+        d->next_donor = NULL;
+        proc_wait_kind(d) = WAIT_NOTHING;
+        proc_wait_id(d) = 0;
+        d = next;
+    }
+    holder->donors = NULL;
+}
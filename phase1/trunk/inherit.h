@@ -0,0 +1,21 @@
+#ifndef INHERIT_H
+#define INHERIT_H
+
+#include "kernel.h"
+
+/* What a blocked process is waiting on its 'lent_to' for: the 'wait_id'
+ * that goes with each is a pid, pid, and mailbox ID. */
+#define WAIT_NOTHING 0
+#define WAIT_ZAP     1  /* to quit, after we zapped it */
+#define WAIT_JOIN    2  /* to quit: it's our only child */
+#define WAIT_MBOX    3  /* to receive from a mailbox it filled */
+
+extern unsigned int deadlocks_found;
+
+void inherit_init(void);
+void lend(proc_struct *donor, proc_struct *holder, int kind, int id);
+void reclaim(proc_struct *donor);
+void release_donors(proc_struct *holder);
+void update_priority(proc_struct *p);
+
+#endif  /* INHERIT_H */
@@ -17,6 +17,7 @@
 #define ETINYSTACK  2
 #define ENOKIDS     2
 #define EBADPID     2
+#define EOVERLOAD   3
 
 /* Must be > MIN_BLOCK_CODE, which is 10 decimal (see above) */
 #define CLEARED_CODE        0
@@ -41,40 +42,108 @@
 #define code(a) (a->status)
 
 typedef struct _proc_struct proc_struct;
+typedef struct _proc_cold proc_cold;
+typedef struct _prio_list prio_list;
 typedef int(*process_func_t)(char *);
 typedef proc_struct *proc_ptr;
 
+/* The process table is split in two.  proc_struct has what the
+ * scheduler and the queue code look at all the time, ready list links
+ * first.  proc_cold has the big stuff only needed at fork, launch,
+ * context switch and for printing: it lives in ProcCold[], at the same
+ * index as the proc_struct in ProcTable[].  Get at it with the
+ * accessors below. */
 struct _proc_struct
 {
    proc_struct *next_proc_ptr;
-   proc_struct *child_proc_ptr;
-   proc_struct *next_sibling_ptr;
-   proc_struct *parent;
+   proc_struct *prev_proc_ptr;
+   prio_list   *on_list;          /* ready or wait list we're queued on */
+   int            priority;         /* what we run at: see inherit.c */
+   int            own_priority;     /* same, unless somebody's lending */
+   long long      pass;             /* stride scheduling: see scheduler.c */
+   int            status;           /* codes associated with QUIT, BLOCKED */
+   int            timeslice_start;  /* in useconds */
+   int            execution_time;   /* in useconds */
+   int            charged_time;     /* execution_time already added to pass */
+   int            stride;
+   int            period;           /* EDF reservation, in useconds: */
+   int            budget_left;      /*   0 period means there isn't one */
+   int            deadline;         /* sys_clock() time */
+   short          pid;               /* process id */
+   unsigned char  flags;            /* READY, BLOCKED, QUIT, etc. */
+   unsigned char  is_zapped;
+
    proc_struct *zappee;           /* pointer to process we're zapping */
+   proc_struct *zappers;          /* processes blocked zapping us */
+   proc_struct *next_zapper;      /* next on our zappee's 'zappers' list */
+   proc_struct *lent_to;          /* whom we're lending our priority to */
+   proc_struct *donors;           /* processes lending theirs to us */
+   proc_struct *next_donor;       /* next on our lent_to's 'donors' list */
+   proc_struct *child_proc_ptr;     /* children that haven't quit */
+   proc_struct *quit_kids;          /* quit but unjoined, in quit order:
+                                       join takes from the front */
+   proc_struct *next_sibling_ptr;   /* on parent's live or quit list */
+   proc_struct *prev_sibling_ptr;   /* live list only */
+   proc_struct *parent;
+   unsigned short live_kids;
+};
+
+struct _proc_cold
+{
    char           name[MAXNAME];     /* process's name */
    char           start_arg[MAXARG]; /* args passed to process */
-   context        state;             /* current context for process */
-   short          pid;               /* process id */
-   int            priority;
    int (* start_func) (char *);   /* function where process begins -- launch */
    char          *stack;
    char          *op;
    unsigned int   stacksize;
-   int            status;           /* codes associated with QUIT, BLOCKED */
-   int            timeslice_start;  /* in useconds */
-   int            execution_time;   /* in useconds */
-
-   unsigned char  flags;            /* READY, BLOCKED, QUIT, etc. */
-   unsigned char  is_zapped;
-
+   context        state;             /* current context for process */
+   int            wait_kind;         /* what lent_to has that we want: */
+   int            wait_id;           /*   see inherit.h */
+   proc_stats     stats;             /* see stats.c */
+   int            state_since;       /* sys_clock() at the last status change */
+   int            block_reason;      /* STAT_BLOCK_*, from the last block */
+   int            woken;             /* ready because it was unblocked */
+   int            base_priority;     /* what fork1 was given */
+   int            tickets;           /* stride is computed from these */
+   int            budget;            /* EDF reservation's, per period */
+   proc_struct   *quit_kids_tail;    /* quit_kids is joined from the front */
+   unsigned short unjoined_kids;
 };
 
+extern proc_struct ProcTable[];
+extern proc_cold ProcCold[];
+
+#define COLD(a) (ProcCold + ((a) - ProcTable))
+
+#define proc_name(a)       (COLD(a)->name)
+#define proc_start_arg(a)  (COLD(a)->start_arg)
+#define proc_start_func(a) (COLD(a)->start_func)
+#define proc_stack(a)      (COLD(a)->stack)
+#define proc_op(a)         (COLD(a)->op)
+#define proc_stacksize(a)  (COLD(a)->stacksize)
+#define proc_state(a)      (COLD(a)->state)
+#define proc_wait_kind(a)  (COLD(a)->wait_kind)
+#define proc_wait_id(a)    (COLD(a)->wait_id)
+#define proc_base_priority(a)  (COLD(a)->base_priority)
+#define proc_tickets(a)        (COLD(a)->tickets)
+#define proc_budget(a)         (COLD(a)->budget)
+#define proc_quit_kids_tail(a) (COLD(a)->quit_kids_tail)
+#define proc_unjoined_kids(a)  (COLD(a)->unjoined_kids)
+
 typedef struct
 {
     proc_struct *front;
     proc_struct *back;
 } ll_node;
 
+/* One queue per priority, plus a bitmap of which queues are non-empty:
+ * bit (priority - 1) is set iff queue[priority - 1] has an entry. */
+struct _prio_list
+{
+    unsigned int occupied;
+    ll_node queue[LOWEST_PRIORITY];
+};
+
 
 struct psr_bits
 {
@@ -11,6 +11,10 @@
 
 #include "kernel.h"
 #include "utility.h"
+#include "stack_pool.h"
+#include "scheduler.h"
+#include "inherit.h"
+#include "stats.h"
 #include "phase1.h"
 
 #include <string.h>
@@ -21,12 +25,13 @@ extern int start1 (char *);
 
 int debugflag = NO_DEBUG;
 
-/* the process table */
+/* the process table: see kernel.h for the hot/cold split */
 proc_struct ProcTable[MAXPROC];
+proc_cold ProcCold[MAXPROC];
 
 /* Zeroed because it's global, see 6.7.8-10 of C99 standard */
-ll_node ReadyList[PRIO_SIZE];   /* ready to execute tasks go here */
-ll_node WaitList[PRIO_SIZE];    /* blocked or sleeping tasks go here*/
+prio_list ReadyList;            /* ready to execute tasks go here */
+prio_list WaitList;             /* blocked or sleeping tasks go here*/
 
 /* current process ID */
 proc_struct *Current;
@@ -34,6 +39,9 @@ proc_struct *Current;
 /* the next pid to be assigned */
 unsigned int next_pid = SENTINELPID;
 
+/* Clock interrupts skip_tick() told the handler it could ignore */
+unsigned int ticks_skipped = 0;
+
 
 /* -------------------------- Functions ----------------------------------- */
 
@@ -59,6 +67,9 @@ startup(void)
         int_vec[i] = bad_interrupt;
 
    int_vec[CLOCK_DEV] = clock_handler;
+
+   sched_init();
+   inherit_init();
    
    /* startup a sentinel process */
     DP(DEBUG3, "calling fork1() for sentinel\n");
@@ -93,6 +104,9 @@ void
 finish(void)
 {
     DP(DEBUG,"in finish...\n");
+#ifdef KERNEL_TRACE
+    trace_dump();
+#endif
 }
 
 /* ------------------------------------------------------------------------
@@ -119,12 +133,12 @@ finish(void)
 int
 fork1(char *name, process_func_t f, char *arg, int stacksize, int priority)
 {
-   int proc_slot = 0;
+   int pid;
    proc_struct *new_entry = NULL;
 
    /* test if in kernel mode; halt if in user mode */
     if (!IS_IN_KERNEL)
-        KERNEL_ERROR("'%s' pid %d is not in kernel mode", Current->name, Current->pid);
+        KERNEL_ERROR("'%s' pid %d is not in kernel mode", proc_name(Current), Current->pid);
 
     DP(DEBUG2, "creating process %s\n", name ? name : "NULL");
 
@@ -161,62 +175,81 @@ fork1(char *name, process_func_t f, char *arg, int stacksize, int priority)
      * avoid their being in an inconsistent state. */
     disableInterrupts();
 
-    DP(DEBUG3, "Finding empty process slot\n");
+    DP(DEBUG3, "Finding pid and empty process slot\n");
 
-   /* find an empty slot in the process table */
-    proc_slot = get_empty_process_slot(f == sentinel);
-    if (proc_slot < 0)
+   /* find a pid whose slot in the process table is empty */
+    pid = find_pid(next_pid);
+    if (pid < 0)
     {
         DP(DEBUG, "No empty process slots for '%s'", name);
         ENABLE_INTERRUPTS;
-        return proc_slot;   /* no empty slots */ 
+        return -ENOPIDS;    /* no empty slots */ 
     }
 
-    new_entry = ProcTable + proc_slot;
+    new_entry = ProcTable + PID_TO_SLOT(pid);
 
-    strncpy(new_entry->name, name, MAXNAME - 1);
+    strncpy(proc_name(new_entry), name, MAXNAME - 1);
 
     /* NULL arg is okay. */
     if (!arg)
-        strcpy(new_entry->start_arg,"");
+        strcpy(proc_start_arg(new_entry),"");
     else if (strlen(arg) > (MAXARG - 1))
         KERNEL_ERROR("argument too long.");
     else
-        strncpy(new_entry->start_arg, arg, MAXNAME - 1);
+        strncpy(proc_start_arg(new_entry), arg, MAXNAME - 1);
 
-    new_entry->pid = next_pid;
-    next_pid = find_pid(next_pid, ReadyList, WaitList);
-    if (next_pid == -ENOPIDS)
-    {
-        DP(DEBUG, "No pids remain for '%s'", name);
-        ENABLE_INTERRUPTS;
-        return -ENOPIDS;     
-    }
+    new_entry->pid = pid;
 
     /* Put this last so I don't have to keep doing free()s if other
-     * elements fail. */
+     * elements fail, but before the slot is marked used so that a
+     * failure here leaves it free. */
     if (initialize_process_stack(new_entry, stacksize) != 0)
     {
+        DP(DEBUG, "No stack for '%s'\n", name);
+        new_entry->pid = 0;
+        strcpy(proc_name(new_entry), "");
+        strcpy(proc_start_arg(new_entry), "");
         ENABLE_INTERRUPTS;
         return -EBAD;
     }
 
+    mark_slot_used(PID_TO_SLOT(pid));
+    next_pid = pid + 1;
+
    /* Initialize context for this process, but use launch function pointer for
     * the initial value of the process's program counter (PC)
     */
     DP(DEBUG4, "Calling context init for process '%s'\n", name);
-   context_init( &(new_entry->state), psr_get(), new_entry->stack, launch);
+   context_init( &(proc_state(new_entry)), psr_get(), proc_stack(new_entry), launch);
 
 
     new_entry->next_sibling_ptr = NULL;
+    new_entry->prev_sibling_ptr = NULL;
     new_entry->parent = Current;
     new_entry->zappee = NULL;
+    new_entry->zappers = NULL;
+    new_entry->next_zapper = NULL;
+    new_entry->lent_to = NULL;
+    new_entry->donors = NULL;
+    new_entry->next_donor = NULL;
+    new_entry->on_list = NULL;
     new_entry->priority = priority;
-    new_entry->start_func = f;
-    new_entry->stacksize = stacksize;
+    new_entry->own_priority = priority;
+    proc_base_priority(new_entry) = priority;
+    proc_start_func(new_entry) = f;
+    proc_stacksize(new_entry) = stacksize;
     code(new_entry) = CLEARED_CODE;
     new_entry->timeslice_start = 0;
     new_entry->execution_time = 0;
+    new_entry->charged_time = 0;
+    new_entry->pass = 0;
+    proc_tickets(new_entry) = DEFAULT_TICKETS;
+    new_entry->stride = STRIDE1 / DEFAULT_TICKETS;
+    new_entry->period = 0;
+    proc_budget(new_entry) = 0;
+    new_entry->budget_left = 0;
+    new_entry->deadline = 0;
+    stats_forked(new_entry);
     set_status(new_entry, READY);
     new_entry->is_zapped = NOT_ZAPPED;
 
@@ -228,7 +261,7 @@ fork1(char *name, process_func_t f, char *arg, int stacksize, int priority)
     p1_fork(new_entry->pid);
 
     DP(DEBUG, "complete: new process '%s', pid %d  wth arg '%s'\n",
-              name, new_entry->pid, new_entry->start_arg);
+              name, new_entry->pid, proc_start_arg(new_entry));
 
     /* done modifying ProcTable entry: restore interrupts */
 
@@ -255,7 +288,7 @@ fork1(char *name, process_func_t f, char *arg, int stacksize, int priority)
 
     if (Current)
         DP(DEBUG, "'%s' pid %d priority %d calling dispatcher from fork1\n",
-                  Current->name, Current->pid, Current->priority);
+                  proc_name(Current), Current->pid, Current->priority);
               
     dispatcher();
 
@@ -285,7 +318,8 @@ fork1(char *name, process_func_t f, char *arg, int stacksize, int priority)
     manipulation.  Or so I keep telling myself.
 
     ** join returns info in the order in which children quit by putting
-    quitters at the end of the list of children (where they belong!).
+    quitters at the end of a separate list of quit children (where they
+    belong!), so the one to join is always at the front.
 
    ------------------------------------------------------------------------ */
 
@@ -297,22 +331,27 @@ join(int *status)
     proc_struct *kid = NULL;
 
     DP(DEBUG, "Process '%s', pid %d called join, has %d children\n",
-                    Current->name,Current->pid, count_kids(Current));
+                    proc_name(Current),Current->pid, count_kids(Current));
     DEXEC(DEBUG, display_a_queue(Current->child_proc_ptr, 1));
 
     if (!IS_IN_KERNEL)
-        KERNEL_ERROR("'%s' pid %d is not in kernel mode", Current->name, Current->pid);
+        KERNEL_ERROR("'%s' pid %d is not in kernel mode", proc_name(Current), Current->pid);
 
-    if (!Current->child_proc_ptr)
+    if (!count_kids(Current))
         return -ENOKIDS;
 
     /* Check to see if there're any kids who've quit already */
     do
     {
         disableInterrupts();
-        kid = find_quit_kid(Current->child_proc_ptr);
+        kid = Current->quit_kids;
         if (!kid)
         {
+            /* Only one child it could be: that one has what we want */
+            if (Current->live_kids == 1)
+                lend(Current, Current->child_proc_ptr, WAIT_JOIN,
+                     Current->child_proc_ptr->pid);
+
             ENABLE_INTERRUPTS;
             /* No unjoined children that have quit: block until this happens */
             block_me(BLOCKED_JOIN);
@@ -321,13 +360,13 @@ join(int *status)
 
     /* Interrupts are disabled here */
 
-    DP(DEBUG, "First quit child is %s, %s with pid %d, removing from list of children\n", Current->name, kid->name, kid->pid);
+    DP(DEBUG, "First quit child is %s, %s with pid %d, removing from list of children\n", proc_name(Current), proc_name(kid), kid->pid);
 
     /* Remove the child 'kid' from Current's child list.*/
-    ret = remove_from_child_list(kid, status);
+    ret = remove_from_child_list(status);
 
     DP(DEBUG, "'%s' join complete: %d kids remain : status is %d\n",
-                    Current->name, count_kids(Current), *status);
+                    proc_name(Current), count_kids(Current), *status);
 
     if (is_zapped())
         DP(DEBUG3, "'%s' was zapped while joining\n");
@@ -346,10 +385,11 @@ join(int *status)
    Returns - nothing
    Side Effects - changes the parent of pid child completion status list.
 
-   When a child quits, it is moved to the end of the list of children
-   for its parent.  This enables the condition that joins must happen
-   in the order in which children quit, since children that quit later
-   will be put after children that quit first.
+   When a child quits, it is moved from its parent's list of live
+   children to the end of the parent's list of quit children.  This
+   enables the condition that joins must happen in the order in which
+   children quit, since children that quit later will be put after
+   children that quit first.
 
    ------------------------------------------------------------------------ */
 
@@ -361,72 +401,82 @@ quit(int code)
     if (!Current)
         KERNEL_ERROR("Current is NULL!");
 
-    DP(DEBUG, "Process '%s' with pid %d code %d is quitting\n", Current->name, Current->pid, code);
+    DP(DEBUG, "Process '%s' with pid %d code %d is quitting\n", proc_name(Current), Current->pid, code);
 
     DEXEC(DEBUG5, display_raw_proc(Current));
 
     if (!IS_IN_KERNEL)
-        KERNEL_ERROR("'%s' pid %d is not in kernel mode", Current->name, Current->pid);
+        KERNEL_ERROR("'%s' pid %d is not in kernel mode", proc_name(Current), Current->pid);
 
     /* Cannot quit if have unquit kids */
     if (count_unquit_kids(Current))
         KERNEL_ERROR("Process '%s' pid %d has %d unquit children!",
-                        Current->name, Current->pid,count_unquit_kids(Current));
+                        proc_name(Current), Current->pid,count_unquit_kids(Current));
 
     /* Modifying list of children: disable interrupts */
     disableInterrupts();
-    Current->execution_time += sys_clock() - Current->timeslice_start;
+    account_cpu(Current);
 
     /* start1 and sentinel only */
     if (!Current->parent)
         goto parentless_quit;
 
     DP(DEBUG3, "Moving '%s' to end of parent's - '%s' pid '%d' - child list\n",
-               Current->name, Current->parent->name, Current->parent->pid);
+               proc_name(Current), proc_name(Current->parent), Current->parent->pid);
 
     p = Current->parent;
     if (!Current->parent->child_proc_ptr)
         KERNEL_ERROR("Process '%s' pid %d priority %d has parent '%s' "
                      "pid %d priority %d but parent has no child list\n",
-                     Current->name, Current->pid, Current->priority,
-                     p->name, p->pid, p->priority);
+                     proc_name(Current), Current->pid, Current->priority,
+                     proc_name(p), p->pid, p->priority);
 
     DP(DEBUG, "Parent '%s' pid %d has %d children\n",
-              Current->parent->name, Current->parent->pid,
+              proc_name(Current->parent), Current->parent->pid,
               count_kids(Current->parent));
 
-    move_to_parent_end(Current->parent->child_proc_ptr);
+    move_to_parent_quit_list();
 
     /* Unblock parent if necessary */
     if (   status(Current->parent, BLOCKED)
         && (code(Current->parent) == BLOCKED_JOIN))
     {
         /* Cannot use unblock_proc here because it's for JOIN. */
-        DP(DEBUG2, "Unblocking joined parent '%s'\n", Current->parent->name);
+        DP(DEBUG2, "Unblocking joined parent '%s'\n", proc_name(Current->parent));
         code(Current->parent) = CLEARED_CODE;
         set_status(Current->parent, READY);
         p = remove_from_waitlist(Current->parent);
+        reclaim(p);
+        TRACE_EVENT(TRACE_UNBLOCK, p->pid, 0);
         add_to_readylist(p);
-        DP(DEBUG, "Parent '%s' pid %d unblocked\n", p->name, p->pid);
+        DP(DEBUG, "Parent '%s' pid %d unblocked\n", proc_name(p), p->pid);
     }
 
 parentless_quit:    
 
-    /* destroy process stack, most cleanup must wait on 'join'. */
-    SMART_FREE(Current->op);
+    /* Give back any EDF reservation */
+    sched_reserve(Current, 0, 0);
+
+    /* Give back process stack, most cleanup must wait on 'join'.  We're
+     * still running on it, but nobody can take it until we're switched
+     * out for good. */
+    release_process_stack(Current);
 
     /* Unblock people who've zapped this task and are blocked */
     if (is_zapped())
         unblock_zappers(Current);
 
+    /* Anybody else lending us priority is on their own now */
+    release_donors(Current);
+
     /* Mark self as quit */
     set_status(Current, QUIT);
     Current->status = code;
 
     p1_quit(Current->pid);
 
-    DP(DEBUG, "Quit complete for '%s' pid %d\n", Current->name, Current->pid);
-    if (Current->parent) DEXEC(DEBUG, display_a_queue(Current->parent->child_proc_ptr, 1));
+    DP(DEBUG, "Quit complete for '%s' pid %d\n", proc_name(Current), Current->pid);
+    if (Current->parent) DEXEC(DEBUG, display_a_queue(Current->parent->quit_kids, 1));
 
     ENABLE_INTERRUPTS;
     dispatcher();
@@ -453,20 +503,20 @@ zap(int pid)
     int ret = 0;
 
     DP(DEBUG2, "'%s' with pid %d is zapping %d\n",
-              Current->name, Current->pid, pid);
+              proc_name(Current), Current->pid, pid);
 
     if (!IS_IN_KERNEL)
-        KERNEL_ERROR("'%s' pid %d is not in kernel mode", Current->name, Current->pid);
+        KERNEL_ERROR("'%s' pid %d is not in kernel mode", proc_name(Current), Current->pid);
 
     if (Current->pid == pid)
         KERNEL_ERROR("Process '%s' pid %d attempting to zap self",
-                        Current->name, pid);
+                        proc_name(Current), pid);
 
     disableInterrupts();
 
-    p = find_process(ReadyList, pid);
+    p = find_process(&ReadyList, pid);
     if (!p)
-        p = find_process(WaitList, pid);
+        p = find_process(&WaitList, pid);
     if (!p)
         KERNEL_ERROR("Process %d attempting to zap non-existant %d",
                      Current->pid, pid);
@@ -477,16 +527,18 @@ zap(int pid)
     if (!status(p, QUIT))
     {
         DP(DEBUG2, "%s pid %d blocking until zappee quits\n",
-                        Current->name, Current->pid);
+                        proc_name(Current), Current->pid);
 
-        /* Record who we're zapping so zappee can find us to unblock us when
-           it quits. */
+        /* Record who we're zapping, and get on the zappee's list of
+           zappers so it can find us to unblock us when it quits. */
         Current->zappee = p;
+        add_zapper(p, Current);
+        lend(Current, p, WAIT_ZAP, p->pid);
         /* Block until zapped process quits */
         ENABLE_INTERRUPTS;
         ret = block_me(BLOCKED_ZAPPING);
 
-        DP(DEBUG2, "%s pid %d unblocking in zap\n",Current->name, Current->pid);
+        DP(DEBUG2, "%s pid %d unblocking in zap\n",proc_name(Current), Current->pid);
 
         /* Don't need zappee info anymore. */
         Current->zappee = NULL;
@@ -507,7 +559,7 @@ int
 is_zapped(void)
 {
     if (!IS_IN_KERNEL)
-        KERNEL_ERROR("'%s' pid %d is not in kernel mode", Current->name, Current->pid);
+        KERNEL_ERROR("'%s' pid %d is not in kernel mode", proc_name(Current), Current->pid);
 
     return Current->is_zapped;
 }
@@ -544,9 +596,6 @@ dump_processes(void)
 "  Pid  PPid  Prio            Status             #Kids     CPU (us)      Name  \n--------------------------------------------------------------------------------\n";
     disableInterrupts();
 
-    /* Seems like a kindly thing to do: most accurate accounting. */ 
-    Current->execution_time += sys_clock() - Current->timeslice_start;
-
     for ( ; i < MAXPROC; ++i)
     {
         if ((count % TERMINAL_LINES) == 0)
@@ -563,8 +612,16 @@ dump_processes(void)
         ++count;
 #endif
     }
+    console("--------------------------------------------------------------------------------\n");
+    dump_stats();
     ENABLE_INTERRUPTS;
     console("--------------------------------------------------------------------------------\n");
+    console("%d of %d process table slots in use\n", count_processes(), MAXPROC);
+    console("%u clock ticks skipped while only one process was runnable\n",
+            ticks_skipped);
+    if (deadlocks_found)
+        console("%u deadlocks found\n", deadlocks_found);
+    dump_stack_pool();
 }
 
 
@@ -577,34 +634,37 @@ dump_processes(void)
 int
 block_me(int block_status)
 {
-    DP(DEBUG, "'%s' pid %d is blocking with code %d\n", Current->name,
+    DP(DEBUG, "'%s' pid %d is blocking with code %d\n", proc_name(Current),
               Current->pid, block_status);
 
     if (block_status < MIN_BLOCK_CODE)
         KERNEL_ERROR("'%s' pid %d invalid block code of %d",
-                        Current->name, Current->pid, block_status);
+                        proc_name(Current), Current->pid, block_status);
 
     disableInterrupts();
 
     /* Set process status */
-    Current->execution_time += sys_clock() - Current->timeslice_start;
+    sched_blocking(Current);
+    account_cpu(Current);
     code(Current) = block_status;
     set_status(Current, BLOCKED);
+    TRACE_EVENT(TRACE_BLOCK, block_status, 0);
 
     /* Add to end of list of waiting processes */
     add_to_waitlist(Current);
 
-    /* Stop executing here until unblocked. */
-    ENABLE_INTERRUPTS;
-    DP(DEBUG, "'%s' pid %d is blocking\n", Current->name, Current->pid);
+    /* Stop executing here until unblocked.  Interrupts stay off until
+     * we're switched out: a device interrupt in between would find
+     * Current blocked on its mailbox and try to unblock Current. */
+    DP(DEBUG, "'%s' pid %d is blocking\n", proc_name(Current), Current->pid);
     dispatcher();
 
-    DP(DEBUG2, "'%s' pid %d is unblocking\n", Current->name, Current->pid);
+    DP(DEBUG2, "'%s' pid %d is unblocking\n", proc_name(Current), Current->pid);
 
     if (is_zapped())
     {
         DP(DEBUG2, "'%s' pid %d zapped while blocking\n",
-                        Current->name, Current->pid);
+                        proc_name(Current), Current->pid);
         return -EZAPPED;
     }
     return 0;
@@ -618,16 +678,18 @@ block_me(int block_status)
     (d) blocked code is > MIN_BLOCK_CODE
 
     Additionally, can't unblock processes that are blocked on a join
-    or by zapping.
+    or by zapping.  A zapped caller still unblocks 'pid' (the clock
+    interrupt calls this on behalf of whoever is Current), and gets
+    -EZAPPED back to tell it so.
 */
 
 int
 unblock_proc(int pid)
 {
     disableInterrupts();
-    proc_struct *p = get_proc_ptr(WaitList, pid);
+    proc_struct *p = get_proc_ptr(&WaitList, pid);
 
-    DP(DEBUG2, "'%s' pid %d is unblocking pid %d\n", Current->name,
+    DP(DEBUG2, "'%s' pid %d is unblocking pid %d\n", proc_name(Current),
                     Current->pid, pid);
 
     if (   (p == NULL)                          /* No process with pid 'pid' */
@@ -651,14 +713,6 @@ unblock_proc(int pid)
         return -EBADPID;
     }
 
-    if (is_zapped())
-    {
-        DP(DEBUG2, "'%s' pid %d was zapped while unblocking %d\n",
-                        Current->name, Current->pid, pid);
-        ENABLE_INTERRUPTS;
-        return -EZAPPED;
-    }
-
     /* Must now remove task from WaitList and add to tail of ReadyList */
 
     p = remove_from_waitlist(p);
@@ -667,16 +721,21 @@ unblock_proc(int pid)
 
     code(p) = CLEAR_FLAGS;
     set_status(p, READY);
+    reclaim(p);
+    TRACE_EVENT(TRACE_UNBLOCK, p->pid, 0);
     add_to_readylist(p);
 
-    DP(DEBUG,"Process '%s' pid %d priority %d added to readylist in unblock_proc\n",
-                    p->name, p->pid, p->priority);
-
     ENABLE_INTERRUPTS;
     /* From the instructions.  "The dispatcher will be called as a
      * side-effect of this function." */
     dispatcher();
 
+    if (is_zapped())
+    {
+        DP(DEBUG2, "'%s' pid %d was zapped while unblocking %d\n",
+                        proc_name(Current), Current->pid, pid);
+        return -EZAPPED;
+    }
     return 0;
 }
 
@@ -694,21 +753,53 @@ read_cur_start_time(void)
     If Current process has exhausted its timeslice, call the
     dispatcher.  Convert execution time to milliseconds for this.
 
-    A timeslice is supposed to be 80ms, and CLOCK_MS is 20ms
-    (usloss.h), thus the magical number 4.
+    How long a timeslice is depends on the scheduling class: see
+    scheduler.c.  Called on every clock interrupt, so the scheduling
+    class gets a look then too.
 */
 
 void
 time_slice(void)
 {
-    #define TIME_SLICE (4 * CLOCK_MS)
+    sched_tick();
 
-    if ( US_TO_MS(sys_clock() - Current->timeslice_start) > TIME_SLICE)
+    if ( US_TO_MS(sys_clock() - Current->timeslice_start) > sched_quantum(Current))
     {
-        DP(DEBUG, "%s pid %d: timeslice over\n", Current->name, Current->pid);
+        DP(DEBUG, "%s pid %d: timeslice over\n", proc_name(Current), Current->pid);
+        sched_expired(Current);
         dispatcher();
     }
-    DP(DEBUG4, "%s pid %d: tick\n", Current->name, Current->pid);
+    DP(DEBUG4, "%s pid %d: tick\n", proc_name(Current), Current->pid);
+}
+
+/*!
+    Tickless clock: returns 1, and counts the tick as skipped, if there
+    is nothing on the ready list but the sentinel, so that whatever is
+    running now would just be picked again.  The clock handler can then
+    skip time_slice() (and anything else it only does for the
+    scheduler's benefit).  Returns 0 if the tick is needed.
+
+    An expired timeslice gets restarted here, just as the dispatcher
+    would have, so that once a second process does become ready,
+    Current isn't preempted for time it ran alone.  Ticks pick back up
+    on their own: the next one after something becomes ready isn't
+    skipped.
+*/
+
+int
+skip_tick(void)
+{
+    /* The sentinel is always ready, so only HIGHEST_PRIORITY through
+     * MINPRIORITY count. */
+    if (ReadyList.occupied & PRIO_AND_HIGHER(MINPRIORITY))
+        return 0;
+
+    if (US_TO_MS(sys_clock() - Current->timeslice_start) > sched_quantum(Current))
+        account_cpu(Current);
+
+    ++ticks_skipped;
+    DP(DEBUG4, "%s pid %d: tick skipped\n", proc_name(Current), Current->pid);
+    return 1;
 }
 
 
@@ -730,29 +821,33 @@ dispatcher(void)
         
     disableInterrupts();
 
+    /* Increment execution time accounting: values in usecs.  Done
+     * before going on the ready list, which is where stride scheduling
+     * charges for it. */
+    if (Current)
+        account_cpu(Current);
 
     /* Blocked, etc. tasks don't go on the readylist */
     if (Current && status(Current, RUNNING))
     {
-        DP(DEBUG,"'%s' pid %d priority %d was running, now in dispatcher\n",
-                 Current->name, Current->priority, Current->pid);
         set_status(Current, READY);
         add_to_readylist(Current);
     }
 
     next_process = get_from_readylist(HIGHEST_PRIORITY);
     remove_from_readylist(next_process);
+    sched_dispatched(next_process);
 
     /* I don't understand this USELESS library junk.  This eventually
      * got things working. Bootiful, aitn't it? */
-    if (!Current && (next_process->start_func == sentinel))
+    if (!Current && (proc_start_func(next_process) == sentinel))
     {
         /* Leave interrupts disabled or suffer the wrath of the
          * clock_handler irritation bug! */
         add_to_readylist(next_process);
         return;
     }
-    if (!Current && (next_process->start_func == start1))
+    if (!Current && (proc_start_func(next_process) == start1))
     {
         /* startup1 during 1st call of dispatcher */
         Current = next_process;
@@ -760,37 +855,34 @@ dispatcher(void)
         set_status(Current, RUNNING);
         p1_switch(Current->pid, next_process->pid);
         ENABLE_INTERRUPTS;
-        context_switch( NULL, &(Current->state));
+        context_switch( NULL, &(proc_state(Current)));
     } else if (!Current)
         KERNEL_ERROR("NULL Current pointer in dispatcher");
 
-    DP(DEBUG, "Expiring process is '%s' pid %d\n", Current->name, Current->pid);
-
     if (Current->pid == next_process->pid)
     {
-        DP(DEBUG, "dispatcher says reexecute same task\n");
-
-        /* Increment execution time accounting: values in usecs */
-        Current->execution_time += sys_clock() - Current->timeslice_start;
         Current->timeslice_start = sys_clock();
         set_status(Current, RUNNING);
         ENABLE_INTERRUPTS;
     } else
     {
-        /* Increment execution time accounting */
-        Current->execution_time += sys_clock() - Current->timeslice_start;
-
         /* Apparently I must set Current myself? */
         p = Current;
+        stats_switched_out(p);
         Current = next_process;
         Current->timeslice_start = sys_clock();
         set_status(Current, RUNNING);
-
-        DP(DEBUG, "SWITCH: from '%s' pid %d priority %d to '%s' pid %d priority %d \n", p->name, p->pid, p->priority, Current->name, Current->pid, Current->priority);
+        TRACE_EVENT(TRACE_SWITCH, p->pid, Current->pid);
 
         p1_switch(Current->pid, next_process->pid);
+
+        /* Interrupts stay off until we're on the new process's stack: a
+         * handler run in between would be on p's stack with Current
+         * already pointing at someone else.  Whoever switches back to
+         * p turns them on again right here (new processes in
+         * launch()). */
+        context_switch( &(proc_state(p)), &(proc_state(Current)));
         ENABLE_INTERRUPTS;
-        context_switch( &(p->state), &(Current->state));
     }
 }
 
@@ -804,3 +896,154 @@ readtime(void)
     return US_TO_MS(Current->execution_time);
 }
 
+/*!
+    Give process 'pid' 'tickets' tickets: its share of the CPU among
+    the processes at its priority, under stride scheduling.  Doesn't do
+    anything under the other scheduling classes, but the tickets are
+    remembered in case.
+
+    Returns 0, -EBAD if 'tickets' isn't 1 .. MAX_TICKETS, or -EBADPID
+    if there's no process 'pid'.
+*/
+
+int
+set_tickets(int pid, int tickets)
+{
+    proc_struct *p;
+
+    if (!IS_IN_KERNEL)
+        KERNEL_ERROR("'%s' pid %d is not in kernel mode", proc_name(Current), Current->pid);
+
+    if ((tickets < 1) || (tickets > MAX_TICKETS))
+        return -EBAD;
+
+    disableInterrupts();
+
+    p = ProcTable + PID_TO_SLOT(pid);
+    if ((pid <= 0) || (p->pid != pid) || status(p, QUIT))
+    {
+        ENABLE_INTERRUPTS;
+        return -EBADPID;
+    }
+
+    DP(DEBUG2, "'%s' pid %d now has %d tickets\n", proc_name(p), pid, tickets);
+
+    proc_tickets(p) = tickets;
+    p->stride = STRIDE1 / tickets;
+
+    ENABLE_INTERRUPTS;
+    return 0;
+}
+
+/*!
+    Process 'donor_pid', which is Current about to block or is already
+    blocked, lends its priority to 'holder_pid' until it's unblocked:
+    for when it's waiting on mailbox 'mbox_id', which 'holder_pid' has
+    filled.  See inherit.c: this is also how deadlocks get noticed.
+    Whatever 'donor_pid' had lent out before is paid back first, so
+    this also moves a loan when what it's waiting on changes hands, and
+    a 'holder_pid' of 0 just cancels it.
+
+    Returns 0, or -EBADPID if either process doesn't exist or 'donor_pid'
+    isn't Current or blocked.
+*/
+
+int
+lend_priority(int donor_pid, int holder_pid, int mbox_id)
+{
+    proc_struct *donor, *holder = NULL;
+
+    if (!IS_IN_KERNEL)
+        KERNEL_ERROR("'%s' pid %d is not in kernel mode", proc_name(Current), Current->pid);
+
+    disableInterrupts();
+
+    donor = ProcTable + PID_TO_SLOT(donor_pid);
+    if (   (donor_pid <= 0) || (donor->pid != donor_pid)
+        || ((donor != Current) && !status(donor, BLOCKED)))
+    {
+        ENABLE_INTERRUPTS;
+        return -EBADPID;
+    }
+
+    if (holder_pid)
+    {
+        holder = ProcTable + PID_TO_SLOT(holder_pid);
+        if ((holder_pid < 0) || (holder->pid != holder_pid) || status(holder, QUIT))
+        {
+            ENABLE_INTERRUPTS;
+            return -EBADPID;
+        }
+    }
+
+    lend(donor, holder, WAIT_MBOX, mbox_id);
+
+    ENABLE_INTERRUPTS;
+    return 0;
+}
+
+/*!
+    Current process asks for an EDF reservation: 'budget' useconds of
+    CPU every 'period' useconds.  Among the ready processes at its
+    priority, it runs before anybody without a reservation, and before
+    anybody with a later deadline.  See scheduler.c.
+
+    A 'period' of 0 gives up the reservation.
+
+    Returns 0, -EBAD if budget isn't 1 .. period, or -EOVERLOAD if
+    taking the reservation would promise more CPU than there is.
+*/
+
+int
+rt_reserve(int period, int budget)
+{
+    int ret;
+
+    if (!IS_IN_KERNEL)
+        KERNEL_ERROR("'%s' pid %d is not in kernel mode", proc_name(Current), Current->pid);
+
+    if ((period < 0) || (period && ((budget < 1) || (budget > period))))
+        return -EBAD;
+
+    disableInterrupts();
+    ret = sched_reserve(Current, period, budget);
+    ENABLE_INTERRUPTS;
+
+    return ret;
+}
+
+/*!
+    Copy process 'pid's scheduling statistics (see stats.c) to 'stats':
+    where its time has gone, how often it's been switched out, and how
+    long it's taken to run after being unblocked.  A process that has
+    quit keeps its statistics until it's joined.
+
+    Returns 0, or -EBADPID if there's no process 'pid'.
+*/
+
+int
+get_proc_stats(int pid, proc_stats *stats)
+{
+    proc_struct *p;
+
+    if (!IS_IN_KERNEL)
+        KERNEL_ERROR("'%s' pid %d is not in kernel mode", proc_name(Current), Current->pid);
+
+    if (!stats)
+        KERNEL_ERROR("NULL proc_stats pointer");
+
+    disableInterrupts();
+
+    p = ProcTable + PID_TO_SLOT(pid);
+    if ((pid <= 0) || (p->pid != pid))
+    {
+        ENABLE_INTERRUPTS;
+        return -EBADPID;
+    }
+
+    stats_read(p, stats);
+
+    ENABLE_INTERRUPTS;
+    return 0;
+}
+
@@ -0,0 +1,306 @@
+/*!
+    Author: Robert Crocombe
+    Class: CS452 Operating Systems Spring 2005
+
+    Scheduling policy, kept apart from the dispatcher's mechanism.
+    dispatcher() always runs the first process on the best non-empty
+    ready queue; what's here decides which queue a process belongs on
+    and how long it gets to run once it's there.
+
+    SCHED_FIXED is how it's always been: the priority given to fork1
+    is it, and everybody gets TIME_SLICE.
+
+    SCHED_MLFQ treats the fork1 priority as the best a process can do.
+    A process that runs through its whole quantum is demoted a level
+    (down to MLFQ_FLOOR), and its quantum doubles for each level it's
+    below where it started.  A process that blocks before its quantum
+    is up moves back up a level.  Every MLFQ_BOOST_PERIOD, everybody
+    goes back to their fork1 priority so demoted processes can't be
+    starved forever.
+
+    SCHED_STRIDE leaves priorities alone -- a ready process at a better
+    priority always wins, so the device drivers still run first -- but
+    shares the CPU between the processes at the same priority in
+    proportion to their tickets (see set_tickets()).  Each process has
+    a 'pass' that goes up by its stride for each ms of execution_time,
+    and ready queues are kept in order of pass, so the dispatcher takes
+    whoever has had the least CPU for their tickets.  A process coming
+    back to the ready list after blocking starts no further back than
+    the last process to run at its priority: no banking up credit by
+    sleeping.
+
+    Independent of the class, a process can take an EDF reservation
+    with rt_reserve(): 'budget' us of CPU every 'period' us.  Ready
+    queues keep processes with reservations at the front, earliest
+    deadline first, so drivers and pagers sharing a priority stop
+    round-robining blindly.  Reservations only get handed out while
+    the total of budget / period stays under EDF_MAX_UTIL.  A process
+    doesn't get to run longer than what's left of its budget at a
+    time, and once it's used all of it, it's queued like a process
+    without a reservation until its deadline goes by: then it gets a
+    new period and a full budget.  A process that wakes up (say, in
+    waitdevice(), because of an interrupt) after its deadline has gone
+    by starts its new period right then, so the deadline it runs with
+    is one period from the wakeup.  Deadlines are sys_clock() times, so
+    they're compared by difference, in case the clock wraps.
+*/
+
+#include "utility.h"
+#include "scheduler.h"
+#include "inherit.h"
+
+#include <stdlib.h>         /* getenv */
+#include <string.h>         /* strcmp */
+
+extern proc_struct *Current;
+extern prio_list ReadyList;
+extern prio_list WaitList;
+
+int sched_class = SCHED_FIXED;
+
+/* When everybody was last put back at their fork1 priority */
+static int last_boost;
+
+/* Stride: pass of the process most recently dispatched at each priority */
+static long long level_pass[LOWEST_PRIORITY];
+
+/* EDF: total of budget / period over all reservations, in EDF_SCALE units */
+static int edf_utilization;
+
+/*!
+    Pick the scheduling class.  Called from startup(), before any
+    processes exist.
+*/
+
+void
+sched_init(void)
+{
+    const char *which = getenv("PHASE1_SCHED");
+
+    if (!which || !strcmp(which, "fixed"))
+        sched_class = SCHED_FIXED;
+    else if (!strcmp(which, "mlfq"))
+        sched_class = SCHED_MLFQ;
+    else if (!strcmp(which, "stride"))
+        sched_class = SCHED_STRIDE;
+    else
+        KERNEL_ERROR("Unknown scheduling class '%s'", which);
+
+    DP(DEBUG, "Scheduling class is %d\n", sched_class);
+}
+
+/*!
+    How long (in ms) 'p' gets to run before time_slice() takes the CPU
+    away.
+*/
+
+int
+sched_quantum(proc_struct *p)
+{
+    int left;
+
+    if (HAS_BUDGET(p))
+    {
+        left = US_TO_MS(p->budget_left);
+        return (left < TIME_SLICE) ? left : TIME_SLICE;
+    }
+    if (sched_class == SCHED_MLFQ)
+        return TIME_SLICE << (p->own_priority - proc_base_priority(p));
+    return TIME_SLICE;
+}
+
+/*!
+    'p' (Current) used up its quantum.  It isn't on any list yet: the
+    dispatcher puts it back on the ready list.
+*/
+
+void
+sched_expired(proc_struct *p)
+{
+    if ((sched_class == SCHED_MLFQ) && (p->own_priority < MLFQ_FLOOR))
+    {
+        DP(DEBUG2, "'%s' pid %d demoted to %d\n", proc_name(p), p->pid,
+                   p->own_priority + 1);
+        p->own_priority += 1;
+        update_priority(p);
+    }
+}
+
+/*!
+    'p' (Current) is about to block, and isn't on any list yet.  If
+    it didn't need all of its quantum, it's not CPU bound.
+*/
+
+void
+sched_blocking(proc_struct *p)
+{
+    if (sched_class != SCHED_MLFQ)
+        return;
+
+    if (   (p->own_priority > proc_base_priority(p))
+        && (US_TO_MS(sys_clock() - p->timeslice_start) < sched_quantum(p)))
+    {
+        DP(DEBUG2, "'%s' pid %d promoted to %d\n", proc_name(p), p->pid,
+                   p->own_priority - 1);
+        p->own_priority -= 1;
+        update_priority(p);
+    }
+}
+
+/*!
+    Called every clock interrupt, from time_slice().  Does the MLFQ
+    anti-starvation boost when it's due.
+*/
+
+void
+sched_tick(void)
+{
+    int i = 0;
+    const int now = sys_clock();
+
+    if (sched_class != SCHED_MLFQ)
+        return;
+
+    if ((now - last_boost) < MLFQ_BOOST_PERIOD)
+        return;
+
+    last_boost = now;
+
+    DP(DEBUG2, "Boosting everybody back to fork1 priorities\n");
+
+    for ( ; i < MAXPROC; ++i)
+    {
+        if (   ProcTable[i].pid
+            && (ProcTable[i].own_priority != proc_base_priority(ProcTable + i)))
+        {
+            ProcTable[i].own_priority = proc_base_priority(ProcTable + i);
+            update_priority(ProcTable + i);
+        }
+    }
+}
+
+/*!
+    'p' is going on the ready list.  Charge it for the CPU it's used
+    since the last time: against its EDF budget, if it has one, and to
+    its pass under stride scheduling.
+*/
+
+void
+sched_ready(proc_struct *p)
+{
+    const int used = p->execution_time - p->charged_time;
+    const int now = sys_clock();
+    long long *floor;
+
+    p->charged_time = p->execution_time;
+
+    if (IS_REALTIME(p))
+    {
+        p->budget_left -= used;
+
+        /* Period's up (or was missed, or slept through): new one from
+         * now.  Until then, a used up budget stays used up. */
+        if ((now - p->deadline) >= 0)
+        {
+            p->deadline = now + p->period;
+            p->budget_left = proc_budget(p);
+        }
+    }
+
+    if (sched_class != SCHED_STRIDE)
+        return;
+
+    p->pass += (long long)p->stride * used / 1000;
+
+    floor = level_pass + p->priority - 1;
+    if (p->pass < *floor)
+        p->pass = *floor;
+}
+
+/*!
+    Returns true if 'a' should be ahead of 'b' on a ready queue (both
+    are at the same priority).  EDF reservations with budget left
+    first, by deadline; then by pass under stride scheduling; otherwise
+    first come, first served.
+*/
+
+int
+sched_runs_before(proc_struct *a, proc_struct *b)
+{
+    if (HAS_BUDGET(a) != HAS_BUDGET(b))
+        return HAS_BUDGET(a);
+
+    if (HAS_BUDGET(a))
+        return (a->deadline - b->deadline) < 0;
+
+    if (sched_class == SCHED_STRIDE)
+        return a->pass < b->pass;
+
+    return 0;
+}
+
+/*!
+    Set (or with a 0 'period', clear) the EDF reservation for 'p', if
+    there's room for it.  Returns 0 or -EOVERLOAD.  'p' must not be on
+    a ready queue: it's Current, or quitting.
+*/
+
+int
+sched_reserve(proc_struct *p, int period, int budget)
+{
+    /* What p has already doesn't count against it */
+    const int mine = IS_REALTIME(p)
+                   ? (int)((long long)proc_budget(p) * EDF_SCALE / p->period) : 0;
+    const int wanted = period ? (int)((long long)budget * EDF_SCALE / period) : 0;
+
+    if (edf_utilization - mine + wanted > EDF_MAX_UTIL)
+    {
+        DP(DEBUG, "'%s' pid %d reservation %d/%d rejected: at %d of %d\n",
+                  proc_name(p), p->pid, budget, period,
+                  edf_utilization, EDF_MAX_UTIL);
+        return -EOVERLOAD;
+    }
+
+    edf_utilization += wanted - mine;
+
+    DP(DEBUG2, "'%s' pid %d reserved %d us every %d us: total now %d\n",
+               proc_name(p), p->pid, budget, period, edf_utilization);
+
+    p->period = period;
+    proc_budget(p) = budget;
+    p->budget_left = budget;
+    p->deadline = sys_clock() + period;
+    p->charged_time = p->execution_time;
+    return 0;
+}
+
+/*!
+    The dispatcher took 'p' off the ready list to run it.
+*/
+
+void
+sched_dispatched(proc_struct *p)
+{
+    if (sched_class == SCHED_STRIDE)
+        level_pass[p->priority - 1] = p->pass;
+}
+
+/*!
+    Change the priority 'p' runs at.  Use update_priority() (inherit.c)
+    instead unless you're it.  If it's sitting on a queue, it has to
+    move to the queue for its new priority: it goes on the end.
+*/
+
+void
+set_priority(proc_struct *p, int priority)
+{
+    prio_list *list = p->on_list;
+
+    if (list)
+        remove_from_within_list(list, p);
+
+    p->priority = priority;
+
+    if (list)
+        add_to_list(list, p);
+}
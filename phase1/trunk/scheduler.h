@@ -0,0 +1,53 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "kernel.h"
+
+/* Scheduling classes.  The class is picked once, at startup, from the
+ * PHASE1_SCHED environment variable ("fixed", "mlfq" or "stride"). */
+#define SCHED_FIXED  0  /* priority given to fork1, round robin within it */
+#define SCHED_MLFQ   1  /* multi-level feedback queue on top of that */
+#define SCHED_STRIDE 2  /* fixed priorities, stride scheduling within each */
+
+/* A timeslice is supposed to be 80ms, and CLOCK_MS is 20ms (usloss.h),
+ * thus the magical number 4. */
+#define TIME_SLICE (4 * CLOCK_MS)
+
+/* MLFQ: nobody gets demoted to the sentinel's priority */
+#define MLFQ_FLOOR (LOWEST_PRIORITY - 1)
+
+/* MLFQ: how often (in us) everybody goes back to their fork1 priority */
+#define MLFQ_BOOST_PERIOD (1000 * 1000)
+
+/* Stride scheduling: a process's stride is STRIDE1 / tickets, and its
+ * pass goes up by its stride for each ms it runs. */
+#define STRIDE1 (1 << 20)
+#define DEFAULT_TICKETS 100
+#define MAX_TICKETS 10000
+
+/* EDF: total of budget / period over all reservations, in thousandths,
+ * can't go past this.  The rest is left for everybody else. */
+#define EDF_SCALE 1000
+#define EDF_MAX_UTIL 900
+
+/* True if 'p' has an EDF reservation */
+#define IS_REALTIME(p) ((p)->period > 0)
+
+/* True if 'p' has a reservation with budget left in this period: only
+ * then does it get ahead of the processes without one */
+#define HAS_BUDGET(p) (IS_REALTIME(p) && ((p)->budget_left > 0))
+
+extern int sched_class;
+
+void sched_init(void);
+int sched_quantum(proc_struct *p);
+void sched_expired(proc_struct *p);
+void sched_blocking(proc_struct *p);
+void sched_tick(void);
+void sched_ready(proc_struct *p);
+void sched_dispatched(proc_struct *p);
+int sched_reserve(proc_struct *p, int period, int budget);
+int sched_runs_before(proc_struct *a, proc_struct *b);
+void set_priority(proc_struct *p, int priority);
+
+#endif  /* SCHEDULER_H */
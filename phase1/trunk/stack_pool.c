@@ -0,0 +1,182 @@
+/*!
+    Author: Robert Crocombe
+    Class: CS452 Operating Systems Spring 2005
+
+    Recycles process stacks.  Every fork1 used to malloc() a stack and
+    every quit free() it again, which for short-lived processes is a
+    lot of heap churn for memory that's about to be asked for again.
+
+    Stack requests are rounded up to a size class: USLOSS_MIN_STACK
+    times 1, 2, 4 or 8.  Freed stacks go on their class's free list,
+    and the next request for that class takes the most recently freed
+    one, which is the most likely to still be in cache.  The first
+    word of a free stack is the link to the next free one.
+
+    'stack_pool_keep' is how many free stacks a class hangs on to:
+    past that, they really are free()d.  0 turns the pool off.  Sizes
+    past the largest class aren't pooled at all.
+
+    quit() gives its stack back while it's still running on it, so a
+    stack that really is being free()d waits until the next one is:
+    free() can hand a big block straight back to the host, and then
+    the quitting process has no stack to get to the dispatcher on.
+
+    Callers have interrupts disabled (fork1, quit, join).
+*/
+
+#include "utility.h"
+#include "stack_pool.h"
+
+#include <stdlib.h>
+
+typedef struct
+{
+    char *free;             /* most recently freed stack of this class */
+    int free_count;
+    unsigned int hits;      /* requests handed a recycled stack */
+    unsigned int misses;    /* requests that had to malloc() */
+} stack_class;
+
+int stack_pool_keep = STACK_POOL_KEEP;
+
+static stack_class classes[STACK_CLASSES];
+
+/* Uncommon sizes, bigger than any class */
+static unsigned int oversize_allocs;
+
+/* Freed last time, and maybe still in use then */
+static char *deferred;
+
+/*!
+    free() 'mem', once whoever gave it back is done with it.
+*/
+
+static void
+free_later(char *mem)
+{
+    free(deferred);
+    deferred = mem;
+}
+
+/*!
+    Returns the size class for a stack of 'stacksize' bytes, or -1 if
+    it's bigger than the largest class.
+*/
+
+static int
+size_to_class(unsigned int stacksize)
+{
+    int i = 0;
+    for ( ; i < STACK_CLASSES; ++i)
+        if (stacksize <= (USLOSS_MIN_STACK << i))
+            return i;
+    return -1;
+}
+
+/*!
+    Returns a stack of at least 'stacksize' bytes, or NULL if there's
+    no memory.  Doesn't zero the stack.
+*/
+
+char *
+stack_alloc(unsigned int stacksize)
+{
+    const int i = size_to_class(stacksize);
+    stack_class *c;
+    char *mem;
+
+    if (i < 0)
+    {
+        ++oversize_allocs;
+        return (char *)malloc(stacksize);
+    }
+
+    c = classes + i;
+    if (c->free)
+    {
+        mem = c->free;
+        c->free = *(char **)mem;
+        --c->free_count;
+        ++c->hits;
+        DP(DEBUG4, "Recycled stack %08x of class %d\n", mem, i);
+        return mem;
+    }
+
+    ++c->misses;
+    return (char *)malloc(USLOSS_MIN_STACK << i);
+}
+
+/*!
+    Gives back a stack from stack_alloc().  'stacksize' must be the
+    size it was asked for with.
+*/
+
+void
+stack_free(char *mem, unsigned int stacksize)
+{
+    const int i = size_to_class(stacksize);
+    stack_class *c;
+
+    if (!mem)
+        return;
+
+    if (i < 0)
+    {
+        free_later(mem);
+        return;
+    }
+
+    c = classes + i;
+    if (c->free_count >= stack_pool_keep)
+    {
+        free_later(mem);
+        return;
+    }
+
+    *(char **)mem = c->free;
+    c->free = mem;
+    ++c->free_count;
+}
+
+/*!
+    Really free() every stack sitting in the pool.
+*/
+
+void
+stack_pool_trim(void)
+{
+    int i = 0;
+    char *mem;
+
+    for ( ; i < STACK_CLASSES; ++i)
+    {
+        while (classes[i].free)
+        {
+            mem = classes[i].free;
+            classes[i].free = *(char **)mem;
+            free(mem);
+        }
+        classes[i].free_count = 0;
+    }
+}
+
+/*!
+    One line per size class: how often a recycled stack was handed out.
+*/
+
+void
+dump_stack_pool(void)
+{
+    int i = 0;
+    unsigned int total;
+
+    for ( ; i < STACK_CLASSES; ++i)
+    {
+        total = classes[i].hits + classes[i].misses;
+        console("Stack pool %6d bytes: %6u hits %6u misses (%3u%% hit) %3d free\n",
+                USLOSS_MIN_STACK << i, classes[i].hits, classes[i].misses,
+                total ? (100 * classes[i].hits) / total : 0,
+                classes[i].free_count);
+    }
+    console("Stack pool oversize: %u allocs\n", oversize_allocs);
+}
@@ -0,0 +1,18 @@
+#ifndef STACK_POOL_H
+#define STACK_POOL_H
+
+/* Stacks are handed out in size classes of USLOSS_MIN_STACK, 2x, 4x
+ * and 8x that.  Anything bigger goes straight to malloc()/free(). */
+#define STACK_CLASSES 4
+
+/* Default for how many free stacks each class holds on to. */
+#define STACK_POOL_KEEP MAXPROC
+
+extern int stack_pool_keep;
+
+char *stack_alloc(unsigned int stacksize);
+void stack_free(char *mem, unsigned int stacksize);
+void stack_pool_trim(void);
+void dump_stack_pool(void);
+
+#endif  /* STACK_POOL_H */
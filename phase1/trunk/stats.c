@@ -0,0 +1,219 @@
+/*!
+    Author: Robert Crocombe
+    Class: CS452 Operating Systems Spring 2005
+
+    Per-process scheduling statistics (proc_stats, in phase1.h): where a
+    process's time went besides the CPU, how often it was switched out,
+    and how long it waited to run after being unblocked.  Enough to tell
+    a process that's starved for CPU (lots of ready time, involuntary
+    switches) from one that's waiting on I/O (blocked time, voluntary
+    switches).
+
+    Everything is counted off status changes: set_status() hands each
+    one to stats_status(), which charges the time since the last change
+    to the status being left.  CPU time is still execution_time, which
+    account_cpu() keeps.  Switches are counted by the dispatcher, since
+    going from RUNNING to READY doesn't mean another process runs.
+
+    What a blocked process is waiting on comes from its block_me()
+    code: join() and zap() have their own, and phase 2 blocks with
+    MBOX_BLOCK_CODE or DEVICE_BLOCK_CODE and up (see phase1.h).  The
+    code is cleared before the process is made ready again, so the
+    reason is kept from when it blocked.
+
+    Callers have interrupts disabled.
+*/
+
+#include "utility.h"
+#include "stats.h"
+
+#include <string.h>         /* memset */
+
+extern proc_struct *Current;
+
+static int
+block_reason(int code)
+{
+    if (code == BLOCKED_JOIN)
+        return STAT_BLOCK_JOIN;
+    if (code == BLOCKED_ZAPPING)
+        return STAT_BLOCK_ZAP;
+    if (code >= DEVICE_BLOCK_CODE)
+        return STAT_BLOCK_DEVICE;
+    if (code >= MBOX_BLOCK_CODE)
+        return STAT_BLOCK_MBOX;
+    return STAT_BLOCK_OTHER;
+}
+
+/*!
+    Which wakeup_latency bucket 'us' goes in: the number of bits it
+    takes.
+*/
+
+static int
+latency_bucket(int us)
+{
+    int bucket = 0;
+
+    for ( ; (us > 0) && (bucket < STAT_LATENCY_BUCKETS - 1); us >>= 1)
+        ++bucket;
+    return bucket;
+}
+
+/*!
+    Smallest latency (us) that at least 'pct' percent of 'p's wakeups
+    were under, as a bucket's upper bound, or 0 if there weren't any.
+*/
+
+static int
+latency_percentile(proc_struct *p, int pct)
+{
+    const int *hist = COLD(p)->stats.wakeup_latency;
+    int total = 0;
+    int sum = 0;
+    int i;
+
+    for (i = 0; i < STAT_LATENCY_BUCKETS; ++i)
+        total += hist[i];
+    if (!total)
+        return 0;
+
+    for (i = 0; i < STAT_LATENCY_BUCKETS - 1; ++i)
+    {
+        sum += hist[i];
+        if (sum * 100 >= total * pct)
+            break;
+    }
+    return 1 << i;
+}
+
+/*!
+    New process 'p' from fork1(): nothing counted yet.
+*/
+
+void
+stats_forked(proc_struct *p)
+{
+    proc_cold *cold = COLD(p);
+
+    memset(&cold->stats, 0, sizeof(cold->stats));
+    cold->state_since = sys_clock();
+    cold->block_reason = STAT_BLOCK_OTHER;
+    cold->woken = 0;
+}
+
+/*!
+    'p' is going from status 'from' to 'to' (see set_status()).
+*/
+
+void
+stats_status(proc_struct *p, int from, int to)
+{
+    proc_cold *cold = COLD(p);
+    const int now = sys_clock();
+    const int spent = now - cold->state_since;
+
+    switch (from)
+    {
+    case READY:
+        cold->stats.ready_time += spent;
+        if ((to == RUNNING) && cold->woken)
+        {
+            ++cold->stats.wakeup_latency[latency_bucket(spent)];
+            cold->woken = 0;
+        }
+        break;
+    case BLOCKED:
+        cold->stats.blocked_time[cold->block_reason] += spent;
+        cold->woken = (to == READY);
+        break;
+    }
+
+    if (to == BLOCKED)
+        cold->block_reason = block_reason(code(p));
+    cold->state_since = now;
+}
+
+/*!
+    The dispatcher is switching from 'p' to somebody else.  If 'p' is
+    still ready, it didn't go by choice.
+*/
+
+void
+stats_switched_out(proc_struct *p)
+{
+    if (status(p, READY))
+        ++COLD(p)->stats.involuntary_switches;
+    else
+        ++COLD(p)->stats.voluntary_switches;
+}
+
+/*!
+    Copy 'p's statistics to 'stats', counting the time it's been in its
+    present status up to now.
+*/
+
+void
+stats_read(proc_struct *p, proc_stats *stats)
+{
+    proc_cold *cold = COLD(p);
+    const int spent = sys_clock() - cold->state_since;
+
+    *stats = cold->stats;
+    stats->cpu_time = cpu_time(p);
+    if (status(p, READY))
+        stats->ready_time += spent;
+    else if (status(p, BLOCKED))
+        stats->blocked_time[cold->block_reason] += spent;
+}
+
+/*!
+    The second half of dump_processes(): statistics for each process in
+    the table.  Times are in useconds; latency is the wakeup latency
+    that half (p50) and 99 percent (p99) of wakeups were under.
+*/
+
+void
+dump_stats(void)
+{
+    proc_stats stats;
+    proc_struct *p = ProcTable;
+
+    console("  Pid     Ready      Join       Zap      Mbox    Device     Other   Vol  Invol\n");
+    console("--------------------------------------------------------------------------------\n");
+
+    for ( ; p < ProcTable + MAXPROC; ++p)
+    {
+        if (!p->pid)
+            continue;
+
+        stats_read(p, &stats);
+        console("%5d %9d %9d %9d %9d %9d %9d %5d %6d\n",
+                p->pid, stats.ready_time,
+                stats.blocked_time[STAT_BLOCK_JOIN],
+                stats.blocked_time[STAT_BLOCK_ZAP],
+                stats.blocked_time[STAT_BLOCK_MBOX],
+                stats.blocked_time[STAT_BLOCK_DEVICE],
+                stats.blocked_time[STAT_BLOCK_OTHER],
+                stats.voluntary_switches, stats.involuntary_switches);
+    }
+
+    console("  Pid   Wakeups  p50 (us)  p99 (us)\n");
+    console("--------------------------------------------------------------------------------\n");
+
+    for (p = ProcTable; p < ProcTable + MAXPROC; ++p)
+    {
+        int i, wakeups = 0;
+
+        if (!p->pid)
+            continue;
+
+        for (i = 0; i < STAT_LATENCY_BUCKETS; ++i)
+            wakeups += COLD(p)->stats.wakeup_latency[i];
+        if (!wakeups)
+            continue;
+
+        console("%5d %9d %9d %9d\n", p->pid, wakeups,
+                latency_percentile(p, 50), latency_percentile(p, 99));
+    }
+}
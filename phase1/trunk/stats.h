@@ -0,0 +1,12 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "kernel.h"
+
+void stats_forked(proc_struct *p);
+void stats_status(proc_struct *p, int from, int to);
+void stats_switched_out(proc_struct *p);
+void stats_read(proc_struct *p, proc_stats *stats);
+void dump_stats(void);
+
+#endif  /* STATS_H */
@@ -0,0 +1,112 @@
+/*
+This test checks EDF reservations (rt_reserve()):
+
+  - XXp1 and XXp2 reserve 20% of the CPU each and XXp3 reserves
+    nothing.  More than what's left (60%) is turned down, as is a budget
+    longer than its period.  All three block, and start1 (priority 1)
+    wakes them up in the order XXp3, XXp2, XXp1: they should run
+    earliest deadline first (XXp1, then XXp2), and XXp3 last.
+
+  - XXp4 reserves 20 ms every second and then spins for 200 ms, with
+    XXp5 (no reservation) ready at the same priority.  Once XXp4's
+    budget is used up it has to wait behind XXp5, so XXp5 gets to run
+    before XXp4 is done.
+*/
+
+#include <stdio.h>
+#include <usloss.h>
+#include <phase1.h>
+
+#define SLEEP_CODE 11
+
+int XXp1(char *), XXp2(char *), XXp3(char *), XXp4(char *), XXp5(char *);
+int Waker(char *);
+int start1_pid;
+volatile int hog_done;
+
+int start1(char *arg)
+{
+   int status, pid1, pid2, pid3, i;
+
+   printf("start1(): started\n");
+   start1_pid = getpid();
+
+   /* Priority 3: they run, reserve and block once start1 blocks */
+   pid1 = fork1("XXp1", XXp1, NULL, USLOSS_MIN_STACK, 3);
+   pid2 = fork1("XXp2", XXp2, NULL, USLOSS_MIN_STACK, 3);
+   pid3 = fork1("XXp3", XXp3, NULL, USLOSS_MIN_STACK, 3);
+   fork1("Waker", Waker, NULL, USLOSS_MIN_STACK, 4);
+   block_me(SLEEP_CODE);
+
+   printf("start1(): waking XXp3, XXp2 and XXp1\n");
+   unblock_proc(pid3);
+   unblock_proc(pid2);
+   unblock_proc(pid1);
+
+   for (i = 0; i < 4; i++)
+      join(&status);
+
+   fork1("XXp4", XXp4, NULL, USLOSS_MIN_STACK, 3);
+   fork1("XXp5", XXp5, NULL, USLOSS_MIN_STACK, 3);
+   for (i = 0; i < 2; i++)
+      join(&status);
+
+   printf("start1(): done\n");
+   return 0;
+}
+
+int XXp1(char *arg)
+{
+   printf("XXp1(): rt_reserve(100 ms, 20 ms) returned %d\n",
+          rt_reserve(100000, 20000));
+   block_me(SLEEP_CODE);
+   printf("XXp1(): running\n");
+   return 1;
+}
+
+int XXp2(char *arg)
+{
+   printf("XXp2(): rt_reserve(200 ms, 40 ms) returned %d\n",
+          rt_reserve(200000, 40000));
+   block_me(SLEEP_CODE);
+   printf("XXp2(): running\n");
+   return 2;
+}
+
+int XXp3(char *arg)
+{
+   printf("XXp3(): rt_reserve(100 ms, 60 ms) returned %d\n",
+          rt_reserve(100000, 60000));
+   printf("XXp3(): rt_reserve(100 ms, 200 ms) returned %d\n",
+          rt_reserve(100000, 200000));
+   block_me(SLEEP_CODE);
+   printf("XXp3(): running\n");
+   return 3;
+}
+
+int Waker(char *arg)
+{
+   unblock_proc(start1_pid);
+   return 4;
+}
+
+int XXp4(char *arg)
+{
+   int start;
+
+   printf("XXp4(): rt_reserve(1 s, 20 ms) returned %d\n",
+          rt_reserve(1000000, 20000));
+   start = sys_clock();
+   while (sys_clock() - start < 200000)
+      ;
+   hog_done = 1;
+   printf("XXp4(): done spinning\n");
+   return 5;
+}
+
+int XXp5(char *arg)
+{
+   printf("XXp5(): running, XXp4 done spinning: %s\n",
+          hog_done ? "yes" : "no");
+   return 6;
+}
@@ -0,0 +1,95 @@
+/*
+This test checks priority lending through join() and zap(), which only
+happens with PHASE1_INHERIT=all (make check runs it both ways):
+
+  - XXp1 (priority 2) joins its only child XXp2 (priority 5) while
+    Medium (priority 3) is ready.  With lending, XXp2 runs at 2 and
+    quits before Medium runs; without it, Medium goes first.
+
+  - Zapper (priority 2) zaps Target (priority 5) while Medium2
+    (priority 3) is ready.  Same again: with lending, Target runs and
+    quits before Medium2.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <usloss.h>
+#include <phase1.h>
+
+int XXp1(char *), XXp2(char *), Medium(char *);
+int Zapper(char *), Target(char *);
+int target_pid;
+
+int start1(char *arg)
+{
+   int status, pid, i;
+   const char *which = getenv("PHASE1_INHERIT");
+
+   printf("start1(): PHASE1_INHERIT is %s\n", which ? which : "unset");
+
+   fork1("XXp1", XXp1, NULL, USLOSS_MIN_STACK, 2);
+   fork1("Medium", Medium, "Medium", USLOSS_MIN_STACK, 3);
+   for (i = 0; i < 2; i++)
+   {
+      pid = join(&status);
+      printf("start1(): joined with pid %d, status %d\n", pid, status);
+   }
+
+   fork1("Zapper", Zapper, NULL, USLOSS_MIN_STACK, 2);
+   target_pid = fork1("Target", Target, NULL, USLOSS_MIN_STACK, 5);
+   fork1("Medium2", Medium, "Medium2", USLOSS_MIN_STACK, 3);
+   for (i = 0; i < 3; i++)
+   {
+      pid = join(&status);
+      printf("start1(): joined with pid %d, status %d\n", pid, status);
+   }
+
+   quit(0);
+   return 0;
+}
+
+int XXp1(char *arg)
+{
+   int status, pid;
+
+   fork1("XXp2", XXp2, NULL, USLOSS_MIN_STACK, 5);
+   printf("XXp1(): joining with XXp2\n");
+   pid = join(&status);
+   printf("XXp1(): joined with pid %d, status %d\n", pid, status);
+
+   quit(1);
+   return 0;
+}
+
+int XXp2(char *arg)
+{
+   printf("XXp2(): running\n");
+   quit(2);
+   return 0;
+}
+
+int Medium(char *arg)
+{
+   printf("%s(): running\n", arg);
+   quit(3);
+   return 0;
+}
+
+int Zapper(char *arg)
+{
+   int result;
+
+   printf("Zapper(): zapping Target\n");
+   result = zap(target_pid);
+   printf("Zapper(): zap returned %d\n", result);
+
+   quit(4);
+   return 0;
+}
+
+int Target(char *arg)
+{
+   printf("Target(): running, zapped = %d\n", is_zapped());
+   quit(5);
+   return 0;
+}
@@ -0,0 +1,58 @@
+/*
+This test checks stride scheduling's proportional share, so it needs
+PHASE1_SCHED=stride (make check runs it that way):
+
+  - XXp1 and XXp2 are both at priority 3 and spin for the same 1.5
+    seconds of wall clock, but XXp1 has 300 tickets and XXp2 has 100.
+    XXp1 should get three times the CPU, give or take 20%.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <usloss.h>
+#include <phase1.h>
+
+#define SPIN_TIME 1500000
+
+int Spinner(char *);
+int spin_until;
+int cpu_ms[2];
+
+int start1(char *arg)
+{
+   int status, pid1, pid2, i;
+   const char *which = getenv("PHASE1_SCHED");
+
+   if (!which || strcmp(which, "stride"))
+   {
+      printf("start1(): needs PHASE1_SCHED=stride, skipping\n");
+      quit(0);
+   }
+
+   spin_until = sys_clock() + SPIN_TIME;
+   pid1 = fork1("XXp1", Spinner, "0", USLOSS_MIN_STACK, 3);
+   pid2 = fork1("XXp2", Spinner, "1", USLOSS_MIN_STACK, 3);
+   printf("start1(): set_tickets returned %d and %d\n",
+          set_tickets(pid1, 300), set_tickets(pid2, 100));
+
+   for (i = 0; i < 2; i++)
+      join(&status);
+
+   printf("start1(): XXp1 got %s 3 times the CPU XXp2 did (+/- 20%%)\n",
+          (cpu_ms[0] * 10 >= cpu_ms[1] * 24) && (cpu_ms[0] * 10 <= cpu_ms[1] * 36)
+          ? "about" : "NOT");
+
+   quit(0);
+   return 0;
+}
+
+int Spinner(char *arg)
+{
+   while (sys_clock() - spin_until < 0)
+      ;
+   cpu_ms[atoi(arg)] = readtime();
+
+   quit(0);
+   return 0;
+}
@@ -0,0 +1,89 @@
+/*
+This test checks MLFQ demotion and the anti-starvation boost, so it
+needs PHASE1_SCHED=mlfq (make check runs it that way):
+
+  - Hog (priority 2) spins for 2.5 seconds.  Watcher (priority 5, the
+    MLFQ floor) spins until Hog is done.  Hog has to use up its
+    quantum at 2, 3 and 4 (80 + 160 + 320 ms) before it's demoted far
+    enough down for Watcher to get in.
+
+  - Down at the floor, Hog's quantum is 640 ms and it takes turns with
+    Watcher.  Only the boost back to priority 2 (MLFQ_BOOST_PERIOD,
+    1 second) gives it a longer run than that after Watcher has
+    started getting in.
+
+Hog counts a jump of more than 40 ms in sys_clock() as Watcher having
+run in between.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <usloss.h>
+#include <phase1.h>
+
+#define SPIN_TIME 2500000
+#define GAP 40000
+
+int Hog(char *), Watcher(char *);
+volatile int hog_done;
+
+int start1(char *arg)
+{
+   int status, i;
+   const char *which = getenv("PHASE1_SCHED");
+
+   if (!which || strcmp(which, "mlfq"))
+   {
+      printf("start1(): needs PHASE1_SCHED=mlfq, skipping\n");
+      quit(0);
+   }
+
+   fork1("Hog", Hog, NULL, USLOSS_MIN_STACK, 2);
+   fork1("Watcher", Watcher, NULL, USLOSS_MIN_STACK, 5);
+
+   for (i = 0; i < 2; i++)
+      join(&status);
+
+   quit(0);
+   return 0;
+}
+
+int Hog(char *arg)
+{
+   const int start = sys_clock();
+   int now, last = start, run_start = start;
+   int first_gap = 0, longest_after = 0;
+
+   while ((now = sys_clock()) - start < SPIN_TIME)
+   {
+      if (now - last > GAP)
+      {
+         if (!first_gap)
+            first_gap = last - start;
+         else if (last - run_start > longest_after)
+            longest_after = last - run_start;
+         run_start = now;
+      }
+      last = now;
+   }
+   hog_done = 1;
+
+   printf("Hog(): Watcher first got in after at least 500 ms: %s\n",
+          first_gap >= 500000 ? "yes" : "no");
+   printf("Hog(): after that, had a run of over 700 ms: %s\n",
+          longest_after > 700000 ? "yes" : "no");
+
+   quit(1);
+   return 0;
+}
+
+int Watcher(char *arg)
+{
+   while (!hog_done)
+      ;
+   printf("Watcher(): done\n");
+
+   quit(2);
+   return 0;
+}
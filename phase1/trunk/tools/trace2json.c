@@ -0,0 +1,171 @@
+/*!
+    Author: Robert Crocombe
+    Class: CS452 Operating Systems Spring 2005
+
+    trace2json [trace.bin] > trace.json
+
+    Turns the kernel's event trace (see trace.h) into Chrome trace_event
+    JSON, for chrome://tracing or Perfetto.  Each USLOSS process is a
+    thread of one process: switches become "running" slices on the
+    processes' rows, and everything else an instant event on the row of
+    whoever was running, with its arguments.
+
+    A host program: doesn't need USLOSS.
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include <usloss.h>         /* DISK_SEEK, etc. */
+#include <trace.h>
+
+/* pids are shorts in the trace */
+#define MAX_PIDS 32768
+
+static const char *event_names[TRACE_EVENTS] =
+    { "?", "switch", "block", "unblock", "send", "receive", "fault", "disk" };
+
+static char seen[MAX_PIDS];
+static int first = 1;
+
+/*!
+    Print the start of an event, up to where its arguments (if any) go.
+    The first time a pid turns up, its row gets a name first.
+*/
+
+static void
+start_event(const char *name, const char *phase, int pid, int time)
+{
+    if (!seen[pid])
+    {
+        seen[pid] = 1;
+        printf("%s\n  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+               "\"tid\": %d, \"args\": {\"name\": \"pid %d\"}}",
+               first ? "" : ",", pid, pid);
+        first = 0;
+    }
+
+    printf("%s\n  {\"name\": \"%s\", \"ph\": \"%s\", \"pid\": 1, "
+           "\"tid\": %d, \"ts\": %d",
+           first ? "" : ",", name, phase, pid, time);
+    first = 0;
+}
+
+static const char *
+disk_op_name(int opr)
+{
+    switch (opr)
+    {
+    case DISK_READ:   return "read";
+    case DISK_WRITE:  return "write";
+    case DISK_SEEK:   return "seek";
+    case DISK_TRACKS: return "tracks";
+    default:          return "?";
+    }
+}
+
+static void
+instant(trace_record *r)
+{
+    const char *name = (r->event > 0 && r->event < TRACE_EVENTS)
+                     ? event_names[r->event] : "?";
+
+    start_event(name, "i", r->pid, r->time);
+    printf(", \"s\": \"t\", \"args\": {");
+
+    switch (r->event)
+    {
+    case TRACE_BLOCK:
+        printf("\"code\": %d", r->arg1);
+        break;
+    case TRACE_UNBLOCK:
+        printf("\"pid\": %d", r->arg1);
+        break;
+    case TRACE_SEND:
+    case TRACE_RECEIVE:
+        printf("\"mbox\": %d, \"size\": %d", r->arg1, r->arg2);
+        break;
+    case TRACE_FAULT:
+        printf("\"offset\": %d, \"cause\": %d", r->arg1, r->arg2);
+        break;
+    case TRACE_DISK:
+        printf("\"unit\": %d, \"op\": \"%s\", \"where\": %d",
+               TRACE_DISK_UNIT(r->arg1), disk_op_name(TRACE_DISK_OPR(r->arg1)),
+               r->arg2);
+        break;
+    default:
+        printf("\"arg1\": %d, \"arg2\": %d", r->arg1, r->arg2);
+    }
+    printf("}}");
+}
+
+int
+main(int argc, char *argv[])
+{
+    const char *name = (argc > 1) ? argv[1] : TRACE_FILE;
+    FILE *in = fopen(name, "rb");
+    trace_header header;
+    trace_record r;
+    int running = -1;
+    int last = 0;
+    unsigned int i;
+
+    if (!in)
+    {
+        perror(name);
+        return 1;
+    }
+
+    if (   (fread(&header, sizeof(header), 1, in) != 1)
+        || memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)))
+    {
+        fprintf(stderr, "%s: not a kernel trace\n", name);
+        return 1;
+    }
+
+    if (header.dropped)
+        fprintf(stderr, "%s: oldest %u events were overwritten\n",
+                name, header.dropped);
+
+    printf("{\"traceEvents\": [");
+
+    for (i = 0; i < header.records; ++i)
+    {
+        if (fread(&r, sizeof(r), 1, in) != 1)
+        {
+            fprintf(stderr, "%s: truncated after %u events\n", name, i);
+            break;
+        }
+        if (r.pid < 0)
+            continue;
+        last = r.time;
+
+        if (r.event != TRACE_SWITCH)
+        {
+            instant(&r);
+            continue;
+        }
+
+        if (running >= 0)
+        {
+            start_event("running", "E", running, r.time);
+            printf("}");
+        }
+        running = ((r.arg2 >= 0) && (r.arg2 < MAX_PIDS)) ? r.arg2 : -1;
+        if (running >= 0)
+        {
+            start_event("running", "B", running, r.time);
+            printf("}");
+        }
+    }
+
+    if (running >= 0)
+    {
+        start_event("running", "E", running, last);
+        printf("}");
+    }
+
+    printf("\n]}\n");
+    fclose(in);
+    return 0;
+}
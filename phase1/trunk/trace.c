@@ -0,0 +1,80 @@
+/*!
+    Author: Robert Crocombe
+    Class: CS452 Operating Systems Spring 2005
+
+    The kernel's event ring (see trace.h).  Only built with
+    -DKERNEL_TRACE.
+
+    Recording can't disable interrupts -- it's called from inside the
+    dispatcher and interrupt handlers, and the point is to not disturb
+    them -- so a record's place in the ring is claimed with one atomic
+    increment before it's filled in.  An interrupt arriving part way
+    through a record gets the next place, not this one.
+
+    When the ring is full the oldest records are overwritten.
+*/
+
+#ifdef KERNEL_TRACE
+
+#include "utility.h"
+
+#include <trace.h>
+#include <string.h>
+
+extern proc_struct *Current;
+
+static trace_record ring[TRACE_RECORDS];
+
+/* Records ever claimed: the next one goes in ring[next % TRACE_RECORDS] */
+static unsigned int next;
+
+void
+trace_event(int event, int arg1, int arg2)
+{
+    trace_record *r = ring + (__sync_fetch_and_add(&next, 1)
+                              & (TRACE_RECORDS - 1));
+
+    r->time = sys_clock();
+    r->pid = Current ? Current->pid : 0;
+    r->event = event;
+    r->arg1 = arg1;
+    r->arg2 = arg2;
+}
+
+/*!
+    Write the ring out to TRACE_FILE, oldest record first.  Called from
+    finish().
+*/
+
+void
+trace_dump(void)
+{
+    FILE *out = fopen(TRACE_FILE, "wb");
+    trace_header header;
+    unsigned int first = 0;
+    unsigned int i;
+
+    if (!out)
+    {
+        console("Couldn't write trace to '%s'\n", TRACE_FILE);
+        return;
+    }
+
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.records = next;
+    header.dropped = 0;
+    if (next > TRACE_RECORDS)
+    {
+        header.records = TRACE_RECORDS;
+        header.dropped = next - TRACE_RECORDS;
+        first = next;
+    }
+
+    fwrite(&header, sizeof(header), 1, out);
+    for (i = 0; i < header.records; ++i)
+        fwrite(ring + ((first + i) & (TRACE_RECORDS - 1)),
+               sizeof(trace_record), 1, out);
+    fclose(out);
+}
+
+#endif  /* KERNEL_TRACE */
@@ -1,4 +1,8 @@
 #include "utility.h"
+#include "stack_pool.h"
+#include "inherit.h"
+#include "scheduler.h"
+#include "stats.h"
 
 /*!
     Author: Robert Crocombe
@@ -12,14 +16,24 @@
 
 #include <stdlib.h>
 #include <string.h>         /* strlen, strncat, strcpy */
+#include <strings.h>        /* ffs */
 #include <stdarg.h>         /* variadic stuff, see smoosh() routine */
 
 /* Globals from phase1.c kernel file. */
 extern int debugflag;
 extern proc_struct *Current;
-extern ll_node ReadyList[];
-extern ll_node WaitList[];
-extern proc_struct ProcTable[];
+extern prio_list ReadyList;
+extern prio_list WaitList;
+
+/* From phase 2, when it's linked in: 1 while someone waits on a device
+   or a mailbox timeout, which an interrupt will end. */
+extern int check_io(void) __attribute__((weak));
+
+/* Bit set means the process table slot is in use.  Kept by fork1 and
+ * zeroize_proc_entry() so nobody has to go poking at ProcTable entries
+ * to find a free one. */
+static unsigned int slot_map[SLOT_MAP_WORDS];
+static int slots_in_use;
 
 /* ------------------------------------------------------------------------
    Name - launch
@@ -35,15 +49,15 @@ launch(void)
     int result;
 
     DP(DEBUG, "started: launching process '%s' pid %d priority %d \n",
-                    Current->name, Current->pid, Current->priority);
+                    proc_name(Current), Current->pid, Current->priority);
 
     enableInterrupts();
 
     /* Call the function passed to fork1, and capture its return value */
-    result = Current->start_func(Current->start_arg);
+    result = proc_start_func(Current)(proc_start_arg(Current));
 
     DP(DEBUG, "Process '%s' pid %d priority %d returned to launch\n",
-              Current->name, Current->pid, Current->priority);
+              proc_name(Current), Current->pid, Current->priority);
 
     quit(result);
 }
@@ -74,11 +88,13 @@ sentinel(char * dummy)
 /*
     Deadlock is considered to have occured if:
         -- There are tasks on the wait list and the sentinel is running
-        (only way check_deadlock can be called currently).  Since there are
-        no I/O devices, this means that a process is blocked on a condition
-        that can never occur (because *everything* is blocked, or else
-        sentinel wouldn't be running).
+        (only way check_deadlock can be called currently), and nobody is
+        waiting on an interrupt (check_io(), if phase 2 provides it).  This
+        means that a process is blocked on a condition that can never occur
+        (because *everything* is blocked, or else sentinel wouldn't be
+        running).
 
+    If waiting on I/O: return, and the sentinel waits for the interrupt
     If deadlock has occured: halt w/ error
     If deadlock hasn't occured, then all tasks are complete: halt w/ okay
 */
@@ -86,6 +102,9 @@ sentinel(char * dummy)
 void
 check_deadlock(void)
 {
+    if (check_io && check_io())
+        return;
+
     if (!waitlist_is_empty())
         KERNEL_ERROR("deadlock: %d processes remain in sentinel",
                         count_processes());
@@ -105,7 +124,7 @@ enableInterrupts(void)
     DP(DEBUG4, "Enabling interrupts\n");
 
     if (!IS_IN_KERNEL)
-        KERNEL_ERROR("'%s' pid %d not in kernel mode.", Current->name,
+        KERNEL_ERROR("'%s' pid %d not in kernel mode.", proc_name(Current),
                         Current->pid);
    
     psr_set(psr_get() | PSR_CURRENT_INT);
@@ -133,7 +152,7 @@ restoreInterrupts(void)
     int psr;
 
     if (!IS_IN_KERNEL)
-        KERNEL_ERROR("'%s' pid %d not in kernel mode.", Current->name,
+        KERNEL_ERROR("'%s' pid %d not in kernel mode.", proc_name(Current),
                         Current->pid);    
 
     DP(DEBUG5,"Before restoring: Current == %s Previous == %s\n",
@@ -165,7 +184,7 @@ disableInterrupts(void)
 
     /* turn the interrupts OFF iff we are in kernel mode */
     if (!IS_IN_KERNEL)
-        KERNEL_ERROR("'%s' pid %d not in kernel mode", Current->name,
+        KERNEL_ERROR("'%s' pid %d not in kernel mode", proc_name(Current),
                         Current->pid);
 
     psr = psr_get();
@@ -175,46 +194,6 @@ disableInterrupts(void)
 }
 
 
-/*!
-  Find an empty slot in the process table.  Start with the slot next to
-  the slot used by the Current process.  If Current is NULL, it had
-  better be at OS start, at which point the sentinel's assigned slot
-  (slot 0) is returned.
-*/
-
-int
-get_empty_process_slot(int sentinel)
-{
-
-    /* This is the index within ProcTable where the current process's
-     * info is stored (or nonsense if Current is NULL.) */
-    const int STARTING_POINT = Current ? Current - ProcTable : 0;
-    int table_slot = STARTING_POINT;
-
-    DP(DEBUG4, "Looking for process table slot\n");
-
-    if (sentinel)
-        return 0;
-
-    /* Starting with the slot for the current process, keep checking
-     * slots until (a) find an empty one (b) iterate over whole of
-     * list. A pid of 0 indicates an empty slot. */
-    do
-    {
-        table_slot = increment_slot(table_slot);
-    } while ((ProcTable[table_slot].pid != 0) && (table_slot != STARTING_POINT));
-
-    if (table_slot == STARTING_POINT)
-    {
-        DP(DEBUG, "'%s' pid %d -- No process slots available",
-                        Current->name, Current->pid);
-        return -ENOPIDS;
-    }
-
-    DP(DEBUG4, "Process table slot found as %d\n", table_slot);
-    return table_slot;
-}
-
 /*!
     Note: Doesn't zero new stack area.
 
@@ -225,6 +204,8 @@ get_empty_process_slot(int sentinel)
 
     However, in order to free the stack at the process' ending, I keep
     an 'original pointer' (op) to the start of the area.
+
+    Stacks come from (and go back to) the stack pool: see stack_pool.c.
 */
 
 int
@@ -232,157 +213,147 @@ initialize_process_stack(proc_struct *p, int stacksize)
 {
     DP(DEBUG4, "Initializing stack for pid %d of size %d\n", p->pid, stacksize);
 
-    char *mem = (char *)malloc(stacksize * sizeof(unsigned char));
+    char *mem = stack_alloc(stacksize);
     if (mem == NULL)
         return -EBAD;
 
-    p->op = mem;
-    p->stack = mem + stacksize - 1;
+    proc_op(p) = mem;
+    proc_stack(p) = mem + stacksize - 1;
     return 0;
 }
 
 /*!
-    Finds next pid that doesn't have existing process.
+    Give process 'p's stack back to the stack pool, if it still has
+    one.  Uses 'stacksize', so do this before that's cleared.
+*/
 
-    I check the new pid against the current process' pid.  If that's
-    okay, then I check the ready list and the list of blocked/waiting
-    tasks for conflicts.  If there is no conflict there, then I check
-    the list of children that have quit but are waiting to be joined.
+void
+release_process_stack(proc_struct *p)
+{
+    if (!proc_op(p))
+        return;
 
-    If there is still no conflict, then the pid is valid.
+    stack_free(proc_op(p), proc_stacksize(p));
+    proc_op(p) = NULL;
+    proc_stack(p) = NULL;
+}
 
-    Is this faster than just checking the entire ProcTable?  It is
-    likely to have fewer checks, but there's a lot of pointer chasing.
+/*!
+    Finds the first pid, starting with 'first_pid', whose slot in the
+    process table is empty.  Since the slot is picked by the pid, this
+    is also how fork1 finds its process table slot.
+
+    A pid that's in use -- running, ready, blocked, or quit but not yet
+    joined -- has its slot filled.  The slot bitmap gives the first
+    free slot at or after first_pid's, and the pid is first_pid moved
+    forward by however many slots were skipped.
 */
 
-unsigned int 
-find_pid(unsigned int old_pid, ll_node ready[], ll_node wait[])
+int
+find_pid(unsigned int first_pid)
 {
-    unsigned pid = old_pid + 1;
-    proc_struct *p;
-    int invalid = 0;
-    int i;
+    unsigned int pid = first_pid;
+    int slot;
 
-    DP(DEBUG4, "Looking for new pid after old pid %d\n", old_pid);
+    DP(DEBUG4, "Looking for new pid starting at %d\n", first_pid);
 
-    /* don't return until all possible pids have been checked || we've
-     * found a good one (no conflicts w/ current processes) */
-    do {
+    /* pid 0 is reserved for empty slots, and pid 1 is sentinel pid */
+    if (pid == 0 || pid > MAX_PID)
+        pid = SENTINELPID + 1;
 
-        /* pid 0 is reserved for empty slots, and pid 1 is sentinel pid */
-        pid = (pid == 0 || pid == SENTINELPID) ? SENTINELPID + 1 : pid;
+    slot = find_free_slot(PID_TO_SLOT(pid));
+    if (slot < 0)
+    {
+        DP(DEBUG, "No free pids starting from %d\n", first_pid);
+        return -ENOPIDS;
+    }
 
-        /* Is this the same pid as the Current process? */
-        invalid = Current && (pid == Current->pid);
-        if (invalid)
-        {
-            /* Yup, try the next one. */
-            ++pid;
-            continue;
-        }        
-
-        /* process w/ this pid in ready or wait lists? */
-        invalid = find_process(ready, pid) || find_process(wait, pid);
-        if (invalid)
-        {
-            /* Yup, try the next one. */
-            ++pid;
-            continue;
-        }
+    pid += (slot - PID_TO_SLOT(pid) + MAXPROC) % MAXPROC;
 
-        /* Okay, wasn't in ready or wait lists, but could it have quit
-         * and be waiting to be joined? */
-        for ( i = 0; !invalid && (i < PRIO_SIZE); ++i)
-        {
-            /* Check every child list of every element of queue at
-             * this priority for READY list*/
-            p = ready[i].front; 
-            while (p)
-            {
-                if (find_quit_kid(p))
-                {
-                    invalid = 1;
-                    break;
-                }
-                p = p->next_proc_ptr;
-            }
-
-            if (invalid)
-                break;
-
-            /* Check every child list of every element of queue at
-             * this priority for WAIT list*/
-            p = wait[i].front; 
-            while (p)
-            {
-                if (find_quit_kid(p))
-                {
-                    invalid = 1;
-                    break;
-                }
-                p = p->next_proc_ptr;
-            }
-        }
+    /* Ran off the end of the pids: start over at the bottom. */
+    if (pid > MAX_PID)
+    {
+        pid = SENTINELPID + 1;
+        slot = find_free_slot(PID_TO_SLOT(pid));
+        pid += (slot - PID_TO_SLOT(pid) + MAXPROC) % MAXPROC;
+    }
+
+    DP(DEBUG4, "Next pid is %d in slot %d\n", pid, slot);
+    return pid;
+}
 
-        /* Well, that one was used.  Try next one. */
-        if (invalid)
-            ++pid;
+/*!
+    Returns the first free process table slot at or after 'from',
+    wrapping around at the end of the table, or -1 if the table is full.
+    Looks at the bitmap a word (32 slots) at a time; the word 'from' is
+    in gets looked at twice: once for the slots at or after 'from', and
+    again after wrapping for the ones before it.
+*/
+
+int
+find_free_slot(int from)
+{
+    unsigned int bits;
+    int word;
+    int n = 0;
 
-      /* Quit if we (a) found a good pid (b) wrapped around pid list */
-    } while (invalid && (pid != old_pid));
+    if (slots_in_use == MAXPROC)
+        return -1;
 
-    if (pid == old_pid)
+    for ( ; n <= SLOT_MAP_WORDS; ++n)
     {
-        DP(DEBUG, "No free pids when old pid == %d\n", old_pid);
-        return -ENOPIDS;
+        word = (from / 32 + n) % SLOT_MAP_WORDS;
+        bits = ~slot_map[word];
+
+        /* Slots past MAXPROC don't exist */
+        if ((word == SLOT_MAP_WORDS - 1) && (MAXPROC % 32))
+            bits &= (1U << (MAXPROC % 32)) - 1;
+
+        /* First time through, only slots at or after 'from' */
+        if (n == 0)
+            bits &= ~0U << (from % 32);
+
+        if (bits)
+            return word * 32 + ffs(bits) - 1;
     }
 
-    DP(DEBUG4, "Old pid %d, next pid is %d\n", old_pid, pid);
-    return pid;
+    return -1;
 }
 
 /*!
-    Returns the next slot in the process table.
-
-    Slots run from 0.. (MAXPROC - 1)
+    Keep the slot bitmap and count of used slots up to date.
 */
 
-int
-increment_slot(int current_position)
+void
+mark_slot_used(int slot)
 {
-    int slot = (current_position + 1) % MAXPROC;
-    DP(DEBUG5, "New slot position is %d, old was %d\n", slot, current_position);
-    return slot;
+    slot_map[slot / 32] |= 1U << (slot % 32);
+    ++slots_in_use;
+}
+
+void
+mark_slot_free(int slot)
+{
+    slot_map[slot / 32] &= ~(1U << (slot % 32));
+    --slots_in_use;
 }
 
 /*!
     Return process with pid 'pid', or NULL if no such process exists
     in the list 'list' (one of ready or wait).
+
+    Same as find_process(), but chattier.
 */
 
 proc_struct *
-get_proc_ptr(ll_node list[], int pid)
+get_proc_ptr(prio_list *list, int pid)
 {
-    int i = 0;
-    proc_struct *p = NULL;
+    proc_struct *p;
 
     DP(DEBUG3, "Looking for process with pid %d\n", pid);
 
-    /* Check each priority queue starting w/ highest priority */
-    for ( ; !p && (i < PRIO_SIZE); ++i)
-    {
-        /* If queue is not empty, check that queue */
-        if (list[i].front)
-        {
-            p = list[i].front;
-            while (p)
-            {
-                if (p->pid == pid)
-                    break;
-                p = p->next_proc_ptr;
-            }
-        }
-    }
+    p = find_process(list, pid);
+
     DP(DEBUG3, "process with pid %d %s\n", pid, (p ? "Found" : "Not Found"));
     return p;
 }
@@ -399,30 +370,29 @@ get_proc_ptr(ll_node list[], int pid)
   This is similar to remove_from_list(), except here I have no
   expectation for getting a certain process: all that is given is a
   priority level at which to begin looking for a process.
+
+  The occupancy bitmap means there's no walking of empty queues: mask
+  off the priorities better than 'priority', and the lowest set bit
+  left is the queue to take from.
 */
 
 proc_struct *
 get_from_readylist(int priority)
 {
-    const int index = priority - 1;
+    const unsigned int candidates = ReadyList.occupied & PRIO_AND_LOWER(priority);
     proc_struct *p = NULL;
-    int i = index;
 
     DP(DEBUG4, "Getting process from ReadyList\n");
 
     /* Execute first entry on the queue */
-    for ( ; i < LOWEST_PRIORITY ; ++i)
-    {
-        p = ReadyList[i].front;
-        if (p)
-            break;
-    }
+    if (candidates)
+        p = ReadyList.queue[ffs(candidates) - 1].front;
 
     if (!p)
         KERNEL_ERROR("no process (not even sentinel)?");
 
     DP(DEBUG2, "Got process '%s' with pid %d priority %d\n",
-                    p->name, p->pid, p->priority);
+                    proc_name(p), p->pid, p->priority);
 
     return p;
 }
@@ -436,12 +406,14 @@ get_from_readylist(int priority)
     traversing lists with them seemed to cause me errors eliminated by
     doing the copying to 'p' and 'c' as I have done.  Doesn't seem
     right.  Need to look at C standard.
+
+    The order of live children doesn't matter (join goes by the order
+    in which they quit), so 'c' goes on the front.
 */
 
 void
 add_to_child_list(proc_struct *parent, proc_struct *child)
 {
-    proc_struct *travel;
     proc_struct *p = parent;
     proc_struct *c = child;
 
@@ -453,84 +425,47 @@ add_to_child_list(proc_struct *parent, proc_struct *child)
     }
 
     if (!c)
-        KERNEL_ERROR("No child to add to '%s' pid %d\n", p->name, p->pid);
+        KERNEL_ERROR("No child to add to '%s' pid %d\n", proc_name(p), p->pid);
 
     if (p == c)
-        KERNEL_ERROR("Making '%s' pid %d child of self", p->name, p->pid);
+        KERNEL_ERROR("Making '%s' pid %d child of self", proc_name(p), p->pid);
 
 
     DP(DEBUG3, "Adding %s pid %d to child list of %s pid %d\n",
-                    c->name, c->pid, p->name, p->pid);
+                    proc_name(c), c->pid, proc_name(p), p->pid);
 
-    c->next_sibling_ptr = NULL;
-    travel = p->child_proc_ptr;
-    if (!travel) /* 'p' has no current children */
-    {
-        p->child_proc_ptr = c;
-    } else /* 'p' already has at least 1 child: add 'c' as sibling to it/them */
-    {
-        while(travel->next_sibling_ptr)
-        {
-            DP(DEBUG5, "Child is '%s' pid %d priority %d\n",
-                            travel->name, travel->pid, travel->priority);
-            travel = travel->next_sibling_ptr;
-        }
-        travel->next_sibling_ptr = c;
-    }
+    c->prev_sibling_ptr = NULL;
+    c->next_sibling_ptr = p->child_proc_ptr;
+    if (p->child_proc_ptr)
+        p->child_proc_ptr->prev_sibling_ptr = c;
+    p->child_proc_ptr = c;
+    ++p->live_kids;
 
-    DP(DEBUG,"Adding: '%s' pid %d now has %d children\n", p->name,
+    DP(DEBUG,"Adding: '%s' pid %d now has %d children\n", proc_name(p),
                     p->pid, count_kids(p));
     DEXEC(DEBUG5, display_a_queue(p->child_proc_ptr, 1));
 }
 
 /*!
-    Child pointed to by 'k' is removed and ProcTable entry is zeroed.
-    Return pid if possible (if not zapped), and status info in 'status'.
+    Takes the first child off Current's list of quit children -- the one
+    that quit longest ago -- and zeroes its ProcTable entry.  Returns its
+    pid, and the code it quit with in 'status'.
 */
 
 int
-remove_from_child_list(proc_struct *k, int *status)
+remove_from_child_list(int *status)
 {
     int ret = -ENOKIDS;
-    proc_struct *kid = k;
-    proc_struct *previous = Current->child_proc_ptr;
-
-    if (!previous)
-        KERNEL_ERROR("Child list went empty for '%s' pid %d unexpectedly",
-                     Current->name, Current->pid);
+    proc_struct *kid = Current->quit_kids;
 
-    /* get pointer to kid 'p - 1' if exists (else pointer to 'p') */
-    while (   (previous != kid)
-           && previous->next_sibling_ptr
-           && (previous->next_sibling_ptr != kid))
-    {
-        previous = previous->next_sibling_ptr;
-    }
+    if (!kid)
+        KERNEL_ERROR("Quit child list went empty for '%s' pid %d unexpectedly",
+                     proc_name(Current), Current->pid);
 
-    /* Remove child process from linked list of children */
-    if (previous == kid)
-    {
-        /* I know thse two cases can be combined, but I get confused */
-        if (kid->next_sibling_ptr == NULL)
-        {
-            DP(DEBUG, "Kid '%s' pid %d is only child\n", kid->name, kid->pid);
-            Current->child_proc_ptr = NULL;
-        } else
-        {
-            DP(DEBUG, "Kid '%s' pid %d is first but not only child\n",
-                            kid->name, kid->pid);
-            /* First but not only*/
-            Current->child_proc_ptr = kid->next_sibling_ptr;
-        }
-    }
-    else
-    {
-        DP(DEBUG, "Kid '%s' pid %d is not only child: %d kids\n",
-                        kid->name, kid->pid, count_kids(Current));
-        /* kid is not first on list of children.   Relocate link from
-         * (previous to kid) to (next after kid) in list */
-        previous->next_sibling_ptr = kid->next_sibling_ptr;
-    }
+    Current->quit_kids = kid->next_sibling_ptr;
+    if (!Current->quit_kids)
+        proc_quit_kids_tail(Current) = NULL;
+    --proc_unjoined_kids(Current);
 
     /* Pull kid from list */
     kid->next_sibling_ptr = NULL;
@@ -540,7 +475,7 @@ remove_from_child_list(proc_struct *k, int *status)
     ret = kid->pid;
 
     DP(DEBUG, "After child removed, queue looks like this:\n");
-    DEXEC(DEBUG, display_a_queue(Current->child_proc_ptr, 1));
+    DEXEC(DEBUG, display_a_queue(Current->quit_kids, 1));
 
     /* Cleanup kid entry */
     zeroize_proc_entry(kid);
@@ -549,77 +484,42 @@ remove_from_child_list(proc_struct *k, int *status)
 }
 
 /*!
-    When a child quits, it needs to be moved to the end of its
-    parent's list of children so that joins happen in the order in
-    which children quit.  So that's what this routine does.
+    When a child quits, it comes off its parent's list of live
+    children and goes on the end of the parent's list of quit children,
+    so that joins happen in the order in which children quit.  So
+    that's what this routine does, for Current.
 */
 
 void
-move_to_parent_end(proc_struct *first_kid)
+move_to_parent_quit_list(void)
 {
-    proc_struct *p = first_kid;
-    proc_struct *list_end;
-    proc_struct *previous;
-
-    /* Only child */
-    if ( (p == Current) && (p->next_sibling_ptr == NULL))
-        return;
-
-    if (p == Current)
-    {
-        /* First but not only */
-        Current->parent->child_proc_ptr = p->next_sibling_ptr;
-        DP(DEBUG,"First\n");
-    } else 
-    {
-        DP(DEBUG,"Not first\n");
-
-        /* Not first: at least 2 children */
-        previous = Current->parent->child_proc_ptr;
-        while (previous && (previous->next_sibling_ptr != Current))
-            previous = previous->next_sibling_ptr;
+    proc_struct *p = Current->parent;
 
-        if (!previous)
-            KERNEL_ERROR("Many obscenities needed!");
-
-        previous->next_sibling_ptr = Current->next_sibling_ptr;
-    }
+    /* Off the live list */
+    if (Current->prev_sibling_ptr)
+        Current->prev_sibling_ptr->next_sibling_ptr = Current->next_sibling_ptr;
+    else
+        p->child_proc_ptr = Current->next_sibling_ptr;
 
+    if (Current->next_sibling_ptr)
+        Current->next_sibling_ptr->prev_sibling_ptr = Current->prev_sibling_ptr;
 
-    /* Find end of list */
-    list_end = Current->parent->child_proc_ptr;
-    while (list_end->next_sibling_ptr)
-        list_end = list_end->next_sibling_ptr;
+    --p->live_kids;
 
-    /* Point list end to Current */
-    list_end->next_sibling_ptr = Current;
-    /* Current is at end of list */
+    /* Onto the end of the quit list */
+    Current->prev_sibling_ptr = NULL;
     Current->next_sibling_ptr = NULL;
 
-    DP(DEBUG,"Last: parent has %d children\n", count_kids(Current->parent));
-    DEXEC(DEBUG5, display_a_queue(Current->parent->child_proc_ptr, 1));
+    if (proc_quit_kids_tail(p))
+        proc_quit_kids_tail(p)->next_sibling_ptr = Current;
+    else
+        p->quit_kids = Current;
 
-}
+    proc_quit_kids_tail(p) = Current;
+    ++proc_unjoined_kids(p);
 
-/*!
-    If there is a child in the singly-linked list whose start is pointed to
-    by 'start' with the status QUIT, a pointer to that child be returned.
-    If no such child exists, then NULL is returned.
-*/
-
-proc_struct *
-find_quit_kid(proc_struct *start)
-{
-    proc_struct *kid = start;
-    while (kid)
-    {
-        if (status(kid, QUIT))
-            break;
-        kid = kid->next_sibling_ptr;
-    }
-    if (!kid)
-        DP(DEBUG, "Found no quit but unjoined child\n");
-    return kid;
+    DP(DEBUG,"Last: parent has %d children\n", count_kids(p));
+    DEXEC(DEBUG5, display_a_queue(p->quit_kids, 1));
 }
 
 /*!
@@ -633,26 +533,82 @@ void
 zeroize_proc_entry(proc_struct *p)
 {
     p->next_proc_ptr = NULL;
+    p->prev_proc_ptr = NULL;
     p->child_proc_ptr = NULL;
+    p->quit_kids = NULL;
+    proc_quit_kids_tail(p) = NULL;
     p->next_sibling_ptr = NULL;
+    p->prev_sibling_ptr = NULL;
+    p->live_kids = 0;
+    proc_unjoined_kids(p) = 0;
     p->parent = NULL;
     p->zappee = NULL;
-    strcpy(p->name,"");
-    strcpy(p->start_arg,"");
+    p->zappers = NULL;
+    p->next_zapper = NULL;
+    p->lent_to = NULL;
+    p->donors = NULL;
+    p->next_donor = NULL;
+    proc_wait_kind(p) = WAIT_NOTHING;
+    proc_wait_id(p) = 0;
+    p->on_list = NULL;
+    strcpy(proc_name(p),"");
+    strcpy(proc_start_arg(p),"");
     /* can't do context here */
+    if (p->pid)
+        mark_slot_free(p - ProcTable);
     p->pid = 0;
     p->priority = -1;
-    p->start_func = NULL;
-    p->stack = NULL;
-    SMART_FREE(p->op);  /* where stack is freed: 'op' is original pointer*/
-    p->stacksize = 0;
+    p->own_priority = -1;
+    proc_base_priority(p) = -1;
+    proc_start_func(p) = NULL;
+    release_process_stack(p);   /* 'op' is original pointer */
+    proc_stacksize(p) = 0;
     p->status = CLEARED_CODE;
     p->timeslice_start = 0;
     p->execution_time = 0;
+    p->charged_time = 0;
+    p->pass = 0;
+    proc_tickets(p) = 0;
+    p->stride = 0;
+    p->period = 0;
+    proc_budget(p) = 0;
+    p->budget_left = 0;
+    p->deadline = 0;
     p->flags = CLEAR_FLAGS;
     p->is_zapped = NOT_ZAPPED;
 }
 
+/*!
+    Adds the time 'p' has run since it was last accounted for to its
+    execution time.  Moves 'timeslice_start' up to now so that calling
+    this twice doesn't count the same time twice: block_me and quit both
+    do this, and then the dispatcher does it again.
+*/
+
+void
+account_cpu(proc_struct *p)
+{
+    const int now = sys_clock();
+
+    p->execution_time += now - p->timeslice_start;
+    p->timeslice_start = now;
+}
+
+/*!
+    'p's execution time up to now, for reporting: Current's includes
+    the time it's run since it was last accounted for.  Unlike
+    account_cpu(), this leaves 'timeslice_start' alone, so looking
+    doesn't restart Current's timeslice.
+*/
+
+int
+cpu_time(proc_struct *p)
+{
+    if (p == Current)
+        return p->execution_time + (sys_clock() - p->timeslice_start);
+    return p->execution_time;
+}
+
 /*!
     This is what Patrick wants in terms of info.
 */
@@ -670,8 +626,8 @@ dump_a_process(proc_struct *p)
             p->priority,
             status_to_string(p),
             count_kids(p),
-            p->execution_time,/* usecs */
-            p->name);
+            cpu_time(p),/* usecs */
+            proc_name(p));
 }
 
 /*!
@@ -684,51 +640,23 @@ dump_a_process(proc_struct *p)
 int
 count_kids(proc_struct *p)
 {
-    proc_struct *t = p->child_proc_ptr;
-    int count = 0;
-
-    if (t)
-    {
-        do {
-            ++count;
-            t = t->next_sibling_ptr;
-        } while (t);
-    }
-    return count;
+    return p->live_kids + proc_unjoined_kids(p);
 }
 
 int
 count_unquit_kids(proc_struct *p)
 {
-    proc_struct *t = p->child_proc_ptr;
-    int count = 0;
-
-    if (t)
-    {
-        do {
-            count += !status(t, QUIT);
-            t = t->next_sibling_ptr;
-        } while (t);
-    }
-    return count;
+    return p->live_kids;
 }
 
 /*!
-    Cheap and stupid way to do this.  Normally I'd go through the
-    lists, but I'm tired.
+    Number of process table slots in use, from the slot bitmap's count.
 */
 
 int 
 count_processes(void)
 {
-    int count = 0;
-    int i = 0;
-    for ( ; i < MAXPROC; ++i)
-    {
-        if (ProcTable[i].pid)
-            ++count;
-    }
-    return count;
+    return slots_in_use;
 }
 
 
@@ -873,40 +801,62 @@ bad_interrupt(int dev, int unit)
 /*!
     Adds 'p' to the end of the proper queue (for its priority) of list
     'list' (ready or wait).
+
+    Except: ready queues can be kept in some order by the scheduling
+    class (EDF deadlines, stride pass values: see scheduler.c).  Then
+    'p' goes after everybody it doesn't need to run before.  Usually
+    that's the end anyway.
 */
 
 void
-add_to_list(ll_node list[], proc_struct *p)
+add_to_list(prio_list *list, proc_struct *p)
 {
-    int index;
+    ll_node *q;
+    proc_struct *after;
     if (!p)
         KERNEL_ERROR("process to add is NULL");
 
-    index = p->priority - 1;
+    q = list->queue + p->priority - 1;
+
+    if (list == &ReadyList)
+        sched_ready(p);
 
-    DP(DEBUG, "adding '%s' pid %d w/ priority %d on %s list\n", p->name,
-                    p->pid, p->priority, ((list == ReadyList) ? "READY"
-                    : "WAIT"));
+    after = q->back;
+    if (list == &ReadyList)
+        while (after && sched_runs_before(p, after))
+            after = after->prev_proc_ptr;
 
-    if (list[index].back)
+    if (q->back && !after)
+    {
+        q->front->prev_proc_ptr = p;
+        p->next_proc_ptr = q->front;
+        p->prev_proc_ptr = NULL;
+        q->front = p;
+    }
+    else if (after && (after != q->back))
+    {
+        after->next_proc_ptr->prev_proc_ptr = p;
+        p->next_proc_ptr = after->next_proc_ptr;
+        p->prev_proc_ptr = after;
+        after->next_proc_ptr = p;
+    }
+    else if (q->back)
     {
-        DP(DEBUG5, "queue for priority %d ISN'T empty\n", p->priority);
-        DEXEC(DEBUG5, display_a_queue(list[index].front, 0));
-        list[index].back->next_proc_ptr = p;
+        q->back->next_proc_ptr = p;
+        p->prev_proc_ptr = q->back;
         p->next_proc_ptr = NULL;
-        list[index].back = p;
+        q->back = p;
     }
     else
     {
-        DP(DEBUG5, "queue for priority %d IS empty\n", p->priority);
-        DEXEC(DEBUG5, display_a_queue(list[index].front, 0));
         /* queue is empty */
-        list[index].front = p;
-        list[index].back = p;
+        q->front = p;
+        q->back = p;
         p->next_proc_ptr = NULL;
+        p->prev_proc_ptr = NULL;
+        list->occupied |= PRIO_BIT(p->priority);
     }
-    DP(DEBUG5, "Queue after adding process '%s'\n", p->name);
-    DEXEC(DEBUG5, display_a_queue(list[index].front, 0));
+    p->on_list = list;
 }
 
 /*!
@@ -917,217 +867,208 @@ add_to_list(ll_node list[], proc_struct *p)
     decided to pass that instead.  Meh.
 
     Degenerate case of remove_from_within_list.
+
+    Only the dispatcher uses this, with interrupts already off, and they
+    have to stay off until it's switched processes: turning them on here
+    let an interrupt handler dispatch in the middle of the dispatcher.
 */
 
 proc_struct *
-remove_from_list(ll_node list[], proc_struct *process)
+remove_from_list(prio_list *list, proc_struct *process)
 {
-    int index;
+    ll_node *q;
     proc_struct *c;
     proc_struct *p = process;
 
     if (!p)
         KERNEL_ERROR("pointer was NULL");
 
-    index = p->priority - 1;
+    q = list->queue + p->priority - 1;
 
     /* Queue is empty */
-    if (!list[index].front)
+    if (!q->front)
     {
         DP(DEBUG4, "List empty removing task with priority %d\n", p->priority);
         return NULL;
     }
 
-    disableInterrupts();
-
-    DEXEC(DEBUG5, display_a_queue(list[index].front, 0));
+    DEXEC(DEBUG5, display_a_queue(q->front, 0));
 
     /* Point 'c' to 1st element of queue, advance 'front' ptr to next element.*/
-    c = list[index].front;
-    list[index].front = list[index].front->next_proc_ptr;
+    c = q->front;
+    q->front = q->front->next_proc_ptr;
+    c->on_list = NULL;
+    c->next_proc_ptr = NULL;
 
     /* If queue is now empty then 'back' pointer of queue need also
-     * point to NULL. */
-    if (c == list[index].back)
-        list[index].back = NULL;
+     * point to NULL, and the queue's bit goes away. */
+    if (c == q->back)
+    {
+        q->back = NULL;
+        list->occupied &= ~PRIO_BIT(p->priority);
+    } else
+        q->front->prev_proc_ptr = NULL;
 
     DP(DEBUG3, "Removing process '%s' pid %d priority %d from %s list\n",
-                    c->name, c->pid, c->priority, ((list == ReadyList)
+                    proc_name(c), c->pid, c->priority, ((list == &ReadyList)
                     ? "READY": "WAIT"));
 
-    DEXEC(DEBUG5, display_a_queue(list[index].front, 0));
-    enableInterrupts();
+    DEXEC(DEBUG5, display_a_queue(q->front, 0));
 
     return c;
 }
 
 /*!
-    Find process 'proc' within the list 'list' and remove it.  This is
-    useful for the wait list, where there is little guarantee about
-    where a process that we're interested in might be (as opposed to
-    ready list, where things are on the front).
+    Remove process 'proc' from wherever it is within the list 'list'.
+    This is useful for the wait list, where there is little guarantee
+    about where a process that we're interested in might be (as opposed
+    to ready list, where things are on the front).
 
-    If no such process is found, return NULL.
+    If 'proc' isn't on 'list', return NULL.
 */
 
 proc_struct *
-remove_from_within_list(ll_node list[], proc_struct *proc)
+remove_from_within_list(prio_list *list, proc_struct *proc)
 {
-    proc_struct *p = NULL;
-    proc_struct *previous = NULL;
-    int i = proc->priority - 1;
-
     if (!proc)
         KERNEL_ERROR("process pointer is NULL\n");
 
     DP(DEBUG3, "Removing '%s' pid %d priority %d from list\n",
-                    proc->name, proc->pid, proc->priority);
+                    proc_name(proc), proc->pid, proc->priority);
 
-    /* Find proc and element previous to it in queue */
-    if (list[i].front)
-    {
-        previous = p = list[i].front;
-        while (p && (p != proc))
-        {
-            previous = p;
-            p = p->next_proc_ptr;
-        }
-    }
+    if (proc->on_list != list)
+        return NULL;
 
     /* Remove element from list */
-    if (p)
-        break_list(list, i, p, previous);
+    break_list(list, proc);
 
-    return p;
+    return proc;
 }
 
 /*!
-    Reforms the queue in list 'list' at index 'i' (not priority 'i').
-    'p' is the element we're reforming out (removing from queue), and
-    'previous' is element 'p - 1' in the queue.
+    Reforms the queue in list 'list' for the priority of 'p', which is
+    the element we're reforming out (removing from queue).  Queues are
+    doubly linked, so there's no need to go looking for the element
+    previous to 'p'.
 */
 
 void
-break_list(ll_node list[], int i,proc_struct * const p, proc_struct * const previous)
+break_list(prio_list *list, proc_struct * const p)
 {
-    DP(DEBUG5,"break list for '%s'\n", p->name);
+    ll_node *q = list->queue + p->priority - 1;
 
-    /* Found node and previous node: rejoin list around 'p' */
-    if (p == previous)
-    {
-        DP(DEBUG5,"first\n");
-        /* First in queue */
-        list[i].front = list[i].front->next_proc_ptr;
-        /* Only in queue? */
-        if (list[i].back == p)
-            list[i].back = NULL;
-    } else
-    {
-        DP(DEBUG5,"not first\n");
-        /* Not first (and therefore not only) */
-        previous->next_proc_ptr = p->next_proc_ptr;
-        /* Last? */
-        if (p == list[i].back)
-            list[i].back = previous;
-    }
+    DP(DEBUG5,"break list for '%s'\n", proc_name(p));
+
+    /* Rejoin list around 'p' */
+    if (p->prev_proc_ptr)
+        p->prev_proc_ptr->next_proc_ptr = p->next_proc_ptr;
+    else
+        q->front = p->next_proc_ptr;
+
+    if (p->next_proc_ptr)
+        p->next_proc_ptr->prev_proc_ptr = p->prev_proc_ptr;
+    else
+        q->back = p->prev_proc_ptr;
+
+    /* Only in queue? */
+    if (!q->front)
+        list->occupied &= ~PRIO_BIT(p->priority);
+
+    p->next_proc_ptr = NULL;
+    p->prev_proc_ptr = NULL;
+    p->on_list = NULL;
 }
 
 /*!
-    Checks all entries of all queues in list for a proces with pid
-    'pid'.  Returns pointer to process if found, or NULL if not.
+    Returns pointer to the process with pid 'pid' if it is queued on
+    'list', or NULL if not.
+
+    No searching: the pid gives the slot, and the slot's 'on_list' says
+    which list (if any) the process is on.  A pid <= 0 can't be valid,
+    and if the slot has been reused since, its pid won't match.
 */
 
 proc_struct *
-find_process(ll_node list[], int pid)
+find_process(prio_list *list, int pid)
 {
-    proc_struct *p = NULL;
-    int i = HIGHEST_PRIORITY - 1;
+    proc_struct *p;
 
-    /* For each queue of priority or lower priority */
-    for ( ; !p && (i < PRIO_SIZE); ++i)
-        /* If there are entries in the queue */
-        if (list[i].front)
-        {
-            /* Look for an entry with pid == 'pid' */
-            p = list[i].front;
-            while (p && (p->pid != pid))
-                p = p->next_proc_ptr;
-            if (p)
-                break;
-        }
+    if (pid <= 0)
+        return NULL;
+
+    p = ProcTable + PID_TO_SLOT(pid);
 
     /* Non-NULL if process was found, else NULL*/
-    return p;
+    return (p->pid == pid && p->on_list == list) ? p : NULL;
 }
 
 
 /*!
-    Starting with queues at priority 'priority', return true if there is a
-    task of priority or lower, or false if there isn't.
+    Starting with queues at priority 'priority', return true if there is
+    no task of priority or lower, or false if there is.
 */
 
 int
-list_is_empty(ll_node list[], int priority)
+list_is_empty(prio_list *list, int priority)
 {
-    int i  = priority - 1;
-    for ( ; i < PRIO_SIZE; ++i)
-        if (list[i].front)
-            break;
-    return i == PRIO_SIZE;
+    return !(list->occupied & PRIO_AND_LOWER(priority));
+}
+
+/*!
+    Put 'zapper' on the list of processes that are zapping 'zappee'.
+    The zapper is about to block until the zappee quits.  The list is
+    newest first: unblock_zappers() turns it around.
+*/
+
+void
+add_zapper(proc_struct *zappee, proc_struct *zapper)
+{
+    zapper->next_zapper = zappee->zappers;
+    zappee->zappers = zapper;
 }
 
 /*!
-    Finds processes that have blocked on zapping process 'p', which is
-    quitting, and unblocks them.
+    Unblocks the processes that have blocked on zapping process 'p',
+    which is quitting.  They're all on p's list of zappers, so only
+    the processes being woken get looked at.  They go on the ready
+    list in the order they zapped, as they would coming off the wait
+    list.
 */
 
 void
 unblock_zappers(proc_struct *p)
 {
-    int i = 0;
-    proc_struct *q;
-    proc_struct *previous;
+    proc_struct *q = NULL;
+    proc_struct *next;
 
-    /* For all priorities */
-    for ( ; i < PRIO_SIZE; ++i)
+    /* Reverse the list: oldest zapper first */
+    while (p->zappers)
     {
-        /* if queue at this priority isn't empty */
-        if (WaitList[i].front)
-        {
-            q = WaitList[i].front;
-            previous = q;
-            /* For this priority queue: see if anyone has zapped 'p' */
-            while (q)
-            {
-                if (q->zappee == p)
-                {
-                    /* 'q' is a zapper of 'p': unblock it */
-                    code(q) = CLEARED_CODE;
-                    set_status(q, READY);
-
-                    /* Remove from WaitList: mayn't be first in queue, so
-                     * this is extra work. */
-                    break_list(WaitList, i, q, previous);
-
-                    /* Remove q's link to the list, if any */
-                    q->next_proc_ptr = NULL;
-
-                    /* add 'q' to readylist */
-                    add_to_readylist(q);
-
-                    /* So can continue looking for additional
-                     * elements: start from front so I don't screw up
-                     * logic of continuing from current spot
-                     * XXX: slower! */
-                    previous = q = WaitList[i].front;
-                } else
-                {
-                    /* Look for next element*/
-                    previous = q;
-                    q = q->next_proc_ptr;
-                }
-            }
-        }
+        next = p->zappers->next_zapper;
+        p->zappers->next_zapper = q;
+        q = p->zappers;
+        p->zappers = next;
+    }
+
+    while (q)
+    {
+        next = q->next_zapper;
+        q->next_zapper = NULL;
+
+        /* 'q' is a zapper of 'p': unblock it */
+        code(q) = CLEARED_CODE;
+        set_status(q, READY);
+
+        /* Remove from WaitList: mayn't be first in queue, but the
+         * queue is doubly linked, so no extra work. */
+        remove_from_waitlist(q);
+        reclaim(q);
+        TRACE_EVENT(TRACE_UNBLOCK, q->pid, 0);
+
+        /* add 'q' to readylist */
+        add_to_readylist(q);
+
+        q = next;
     }
 }
 
@@ -1151,8 +1092,11 @@ unblock_zappers(proc_struct *p)
 void
 set_status(proc_struct *p, const int value)
 {
+    int from;
+
     if (!p)
         KERNEL_ERROR("NULL process pointer");
+    from = p->flags;
 
     /* Want we want process to become */
     switch (value)
@@ -1163,7 +1107,7 @@ set_status(proc_struct *p, const int value)
         /* All scheduable tasks must pass through ready list */
         case RUNNING:
             KERNEL_ERROR("RUNNING -> RUNNING for '%s' pid %d\n",
-                         p->name, p->pid);
+                         proc_name(p), p->pid);
             break;
 
         /* Only READY->RUNNING is acceptable transition */
@@ -1172,15 +1116,15 @@ set_status(proc_struct *p, const int value)
             break;
         case BLOCKED:
             KERNEL_ERROR("blocked task '%s' pid %d moved to running?\n",
-                         p->name, p->pid);
+                         proc_name(p), p->pid);
             break;
         case QUIT:
             KERNEL_ERROR("quit task '%s' pid %d moved to running?\n",
-                         p->name, p->pid);
+                         proc_name(p), p->pid);
             break;
         default:
             KERNEL_ERROR("task in UNKNOWN state '%s' pid %d moved to running?\n",
-                         p->name, p->pid);
+                         proc_name(p), p->pid);
         }
         break;
 
@@ -1239,19 +1183,19 @@ set_status(proc_struct *p, const int value)
             break;
         case BLOCKED:
             KERNEL_ERROR("Blocked task '%s' pid %d setting status to quit?",
-                            p->name, p->pid);
+                            proc_name(p), p->pid);
             break;
         case READY:
             KERNEL_ERROR("Ready task '%s' pid %d setting status to quit?",
-                            p->name, p->pid);
+                            proc_name(p), p->pid);
             break;
         case QUIT:
             KERNEL_ERROR("quitting task '%s' pid %d that has already quit",
-                            p->name, p->pid);
+                            proc_name(p), p->pid);
             break;
         default:
             KERNEL_ERROR("trying to QUIT task '%s' pid %d with unknown status %08x",
-                            p->name, p->pid, value);
+                            proc_name(p), p->pid, value);
         }
         break;
 
@@ -1260,8 +1204,10 @@ set_status(proc_struct *p, const int value)
                         value, p->pid);
     }
 
+    stats_status(p, from, value);
+
     DP(DEBUG, "Status of '%s' pid %d after setting status is '%s'\n",
-              p->name, p->pid, status_to_string(p));
+              proc_name(p), p->pid, status_to_string(p));
 }
 
 /*!
@@ -1286,11 +1232,11 @@ void
 display_raw_proc(proc_struct *p)
 {
     console("name %s\npid %d\nprio %d\nstacksize %d status %d timeslice start %d execution time %d\n"
-            "next %08x\nchild %08x\nsibling %08x\nparent %08x\nzappee %08x\n",
-            p->name, p->pid, p->priority, p->stacksize, p->status,
+            "next %08x\nprev %08x\nchild %08x\nsibling %08x\nparent %08x\nzappee %08x\n",
+            proc_name(p), p->pid, p->priority, proc_stacksize(p), p->status,
             p->timeslice_start, p->execution_time,
-            p->next_proc_ptr, p->child_proc_ptr, p->next_sibling_ptr,
-            p->parent, p->zappee);
+            p->next_proc_ptr, p->prev_proc_ptr, p->child_proc_ptr,
+            p->next_sibling_ptr, p->parent, p->zappee);
 }
 
 /*!
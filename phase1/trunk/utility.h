@@ -13,6 +13,7 @@
 #include "kernel.h"
 
 #include <stdio.h>  /* macros may be used in files without stdio.h */
+#include <trace.h>  /* TRACE_EVENT */
 
 /******************************************************************************/
 /* Handy Macros                                                               */
@@ -41,6 +42,14 @@ extern int debugflag;
 /* I find this mnemonic more memorable for for() loops. */
 #define PRIO_SIZE LOWEST_PRIORITY
 
+/* Bit for priority 'a' in a prio_list's occupancy bitmap, and the masks of
+ * that priority and every lower one (numerically greater) or every higher
+ * one.  ffs() on the bitmap then gives the best non-empty priority
+ * directly. */
+#define PRIO_BIT(a) (1U << ((a) - 1))
+#define PRIO_AND_LOWER(a) (~(PRIO_BIT(a) - 1))
+#define PRIO_AND_HIGHER(a) ((PRIO_BIT(a) << 1) - 1)
+
 /* More compact, although does can require an extra psr_get() :( */
 #define CURRENT_INT (psr_get() & PSR_CURRENT_INT)
 #define PREVIOUS_INT (psr_get() & PSR_PREV_INT)
@@ -62,18 +71,29 @@ extern int debugflag;
                                     } \
                                 } while (0)
 
+/* ProcTable is indexed by pid: a process lives in slot pid % MAXPROC.
+ * The pid / MAXPROC part is in effect a generation number for the slot,
+ * so a stale pid never matches whoever has the slot now. */
+#define PID_TO_SLOT(a) ((a) % MAXPROC)
+
+/* proc_struct keeps the pid in a short */
+#define MAX_PID 32767
+
+/* Bitmap of which process table slots are in use, 32 slots per word */
+#define SLOT_MAP_WORDS ((MAXPROC + 31) / 32)
+
 /* For when I need to convert from clock-level accuracy to that
  * demanded by various functions. */
 #define US_TO_MS(a) ((a) / 1000UL)
 
 /* Handy shorthand to provide arguments to more general purpose functions. */
-#define add_to_readylist(a) add_to_list(ReadyList, a)
-#define add_to_waitlist(a) add_to_list(WaitList, a)
+#define add_to_readylist(a) add_to_list(&ReadyList, a)
+#define add_to_waitlist(a) add_to_list(&WaitList, a)
 
-#define remove_from_readylist(a) remove_from_list(ReadyList, a)
-#define remove_from_waitlist(a) remove_from_within_list(WaitList, a)
+#define remove_from_readylist(a) remove_from_list(&ReadyList, a)
+#define remove_from_waitlist(a) remove_from_within_list(&WaitList, a)
 
-#define waitlist_is_empty() list_is_empty(WaitList, HIGHEST_PRIORITY)
+#define waitlist_is_empty() list_is_empty(&WaitList, HIGHEST_PRIORITY)
 
 /******************************************************************************/
 /* Utility Function Prototypes                                                */
@@ -88,19 +108,22 @@ void enableInterrupts(void);
 void restoreInterrupts(void);
 void disableInterrupts(void);
 
-int get_empty_process_slot(int sentinel);
 int initialize_process_stack(proc_struct * proc, int stacksize);
-unsigned int find_pid(unsigned int old_pid, ll_node ready[], ll_node wait[]);
-int increment_slot(int current_position);
+void release_process_stack(proc_struct *p);
+int find_pid(unsigned int first_pid);
+int find_free_slot(int from);
+void mark_slot_used(int slot);
+void mark_slot_free(int slot);
 
-proc_struct *get_proc_ptr(ll_node list[], int pid);
+proc_struct *get_proc_ptr(prio_list *list, int pid);
 proc_struct *get_from_readylist(int priority);
 
 void add_to_child_list(proc_struct *p, proc_struct *c);
-int remove_from_child_list(proc_struct *k, int *status);
-void move_to_parent_end(proc_struct *first_kid);
-proc_struct *find_quit_kid(proc_struct *p);
+int remove_from_child_list(int *status);
+void move_to_parent_quit_list(void);
 
+void account_cpu(proc_struct *p);
+int cpu_time(proc_struct *p);
 void zeroize_proc_entry(proc_struct *p);
 void dump_a_process(proc_struct * p);
 int count_kids(proc_struct *p);
@@ -114,18 +137,18 @@ void kernel_error(const char *func,
                   const char *message);
 char *smoosh(const char *format, ...);
 
+void trace_dump(void);
+
 void clock_handler(int dev, int unit);
 void bad_interrupt(int dev, int unit);
 
-void add_to_list(ll_node list[], proc_struct * p);
-proc_struct *remove_from_list(ll_node list[], proc_struct *p);
-proc_struct *remove_from_within_list(ll_node list[], proc_struct *proc);
-void break_list(ll_node list[],
-                int i,
-                proc_struct * const p,
-                proc_struct * const previous);
-proc_struct *find_process(ll_node list[], int pid);
-int list_is_empty(ll_node list[], int priority);
+void add_to_list(prio_list *list, proc_struct * p);
+proc_struct *remove_from_list(prio_list *list, proc_struct *p);
+proc_struct *remove_from_within_list(prio_list *list, proc_struct *proc);
+void break_list(prio_list *list, proc_struct * const p);
+proc_struct *find_process(prio_list *list, int pid);
+int list_is_empty(prio_list *list, int priority);
+void add_zapper(proc_struct *zappee, proc_struct *zapper);
 void unblock_zappers(proc_struct *p);
 void set_status(proc_struct *p, const int value);
 
@@ -0,0 +1,224 @@
+/*!
+    Author: Robert Crocombe
+    Class: CS452 Operating Systems Spring 2005
+
+    Phase 2 microbenchmarks: "make bench" builds this like a testcase,
+    and "make bench.csv" runs it.
+
+    create_release  MboxCreate() and then MboxRelease() of the new box:
+                    the churn of phase 3 making and dropping a private
+                    box per child
+    lookup          MboxCondReceive() of an empty box, which only finds
+                    the box and says it would block
+    send_receive    MboxSend() of a 4 byte message to a box with a free
+                    slot, then MboxReceive() of it
+    send_receive_many
+                    the same BATCH messages, but with one MboxSendMany()
+                    and one MboxReceiveMany()
+
+    The mailbox benchmarks are run with 0, half of MAXMBOX and all but a
+    few mailboxes already in use (not counting the device mailboxes),
+    which is what made the old searches slow: their 'load' column has
+    the number of boxes in use, device mailboxes included.  send_receive
+    and send_receive_many are run with 0, half of MAXSLOTS and all but
+    a few slots already holding messages, and their 'load' is that
+    number.
+
+    sys_clock() only counts microseconds, so operations are timed in
+    batches of BATCH and each sample is the batch's time / BATCH.
+
+    Output is CSV on stdout, one line per benchmark and load, times in
+    ns per operation.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+
+#define SAMPLES 200
+#define BATCH   50
+
+/* Device mailboxes: clock, disks and terminals */
+#define DEVICE_BOXES (1 + DISK_UNITS + TERM_UNITS)
+
+/* Boxes or slots left free at the heaviest load */
+#define HEADROOM 8
+
+static const int box_loads[] =
+    { 0, MAXMBOX / 2, MAXMBOX - DEVICE_BOXES - HEADROOM };
+static const int slot_loads[] = { 0, MAXSLOTS / 2, MAXSLOTS - HEADROOM };
+#define NUM_LOADS (sizeof(box_loads) / sizeof(box_loads[0]))
+
+static int samples[SAMPLES];
+
+static int held[MAXMBOX];
+static int held_count;
+
+static int
+compare_ints(const void *a, const void *b)
+{
+    return *(const int *)a - *(const int *)b;
+}
+
+static int
+percentile(int pct)
+{
+    return samples[(pct * (SAMPLES - 1)) / 100];
+}
+
+static void
+report(const char *bench, int load, int ops_per_sample)
+{
+    qsort(samples, SAMPLES, sizeof(int), compare_ints);
+
+    printf("%s,%d,%d,%d,%d,%d,%d,%d,%d\n",
+           bench, load, SAMPLES, ops_per_sample,
+           samples[0], percentile(50), percentile(90), percentile(99),
+           samples[SAMPLES - 1]);
+}
+
+/*!
+    Boxes that are just there to be in use until release_held().
+*/
+
+static void
+hold_boxes(int count)
+{
+    for (held_count = 0; held_count < count; ++held_count)
+    {
+        held[held_count] = MboxCreate(1, sizeof(int));
+        if (held[held_count] < 0)
+        {
+            printf("MboxCreate failed after %d boxes\n", held_count);
+            exit(1);
+        }
+    }
+}
+
+static void
+release_held(void)
+{
+    int i = 0;
+
+    for ( ; i < held_count; ++i)
+        MboxRelease(held[i]);
+    held_count = 0;
+}
+
+static void
+bench_create_release(void)
+{
+    int i, j, t0;
+
+    for (i = 0; i < SAMPLES; ++i)
+    {
+        t0 = sys_clock();
+        for (j = 0; j < BATCH; ++j)
+            MboxRelease(MboxCreate(0, 0));
+        samples[i] = (sys_clock() - t0) * 1000 / BATCH;
+    }
+
+    report("create_release", DEVICE_BOXES + held_count, BATCH);
+}
+
+static void
+bench_lookup(void)
+{
+    int box = MboxCreate(1, sizeof(int));
+    int i, j, t0, msg;
+
+    for (i = 0; i < SAMPLES; ++i)
+    {
+        t0 = sys_clock();
+        for (j = 0; j < BATCH; ++j)
+            MboxCondReceive(box, &msg, sizeof(msg));
+        samples[i] = (sys_clock() - t0) * 1000 / BATCH;
+    }
+
+    MboxRelease(box);
+    report("lookup", DEVICE_BOXES + held_count, BATCH);
+}
+
+/*!
+    'buffered' messages are left sitting in a box of their own while
+    another box gets a message sent and received.
+*/
+
+static void
+bench_send_receive(int buffered)
+{
+    int filler = MboxCreate(buffered ? buffered : 1, sizeof(int));
+    int box = MboxCreate(1, sizeof(int));
+    int i, j, t0, msg = 0;
+
+    for (i = 0; i < buffered; ++i)
+        MboxSend(filler, &msg, sizeof(msg));
+
+    for (i = 0; i < SAMPLES; ++i)
+    {
+        t0 = sys_clock();
+        for (j = 0; j < BATCH; ++j)
+        {
+            MboxSend(box, &msg, sizeof(msg));
+            MboxReceive(box, &msg, sizeof(msg));
+        }
+        samples[i] = (sys_clock() - t0) * 1000 / BATCH;
+    }
+
+    MboxRelease(box);
+    MboxRelease(filler);
+    report("send_receive", buffered, BATCH);
+}
+
+static void
+bench_send_receive_many(int buffered)
+{
+    int filler = MboxCreate(buffered ? buffered : 1, sizeof(int));
+    int box = MboxCreate(BATCH, sizeof(int));
+    int msgs[BATCH], sizes[BATCH];
+    int i, t0, msg = 0;
+
+    for (i = 0; i < buffered; ++i)
+        MboxSend(filler, &msg, sizeof(msg));
+    for (i = 0; i < BATCH; ++i)
+        sizes[i] = sizeof(int);
+
+    for (i = 0; i < SAMPLES; ++i)
+    {
+        t0 = sys_clock();
+        MboxSendMany(box, msgs, sizeof(int), sizes, BATCH);
+        MboxReceiveMany(box, msgs, sizeof(int), sizes, BATCH);
+        samples[i] = (sys_clock() - t0) * 1000 / BATCH;
+    }
+
+    MboxRelease(box);
+    MboxRelease(filler);
+    report("send_receive_many", buffered, BATCH);
+}
+
+int
+start2(char *arg)
+{
+    unsigned int i = 0;
+
+    printf("bench,load,samples,ops_per_sample,"
+           "min_ns,p50_ns,p90_ns,p99_ns,max_ns\n");
+
+    for ( ; i < NUM_LOADS; ++i)
+    {
+        hold_boxes(box_loads[i]);
+        bench_create_release();
+        bench_lookup();
+        release_held();
+    }
+
+    for (i = 0; i < NUM_LOADS; ++i)
+        bench_send_receive(slot_loads[i]);
+    for (i = 0; i < NUM_LOADS; ++i)
+        bench_send_receive_many(slot_loads[i] ? slot_loads[i] - BATCH : 0);
+
+    quit(0);
+    return 0;
+}
@@ -1,8 +1,11 @@
 #include <phase1.h>
 #include <phase2.h>
 #include <usloss.h>
+#include <usyscall.h>
 #include "utility.h"
 #include "handler.h"
+#include "helper.h"
+#include "timer.h"
 
 extern int debugflag2;
 extern int device_mbox_ID[];
@@ -19,6 +22,13 @@ nullsys(sysargs *args)
     time_slice() makes the decisions as to whether to call the
     dispatcher or not.
 
+    Timed mailbox waits that are up are woken first (see timer.c).
+
+    Tickless: when nobody is waiting on the clock device or a timer and
+    phase 1 says there's only one process that could run, the tick is
+    skipped entirely.  The count of ticks keeps going, so the clock mailbox
+    still hears every fifth tick once someone waits on it again.
+
     I'm not sure if any return values from MboxCondSend() are errors
     when called in this context, so I'm ignoring the return code.
 */
@@ -27,18 +37,23 @@ void
 clock_handler(int dev, int unit)
 {
     static int counts = 0;
+    int notify;
     DP2(DEBUG3,"handler called\n");
 
     if (dev != CLOCK_DEV)
         KERNEL_ERROR("non-clock device calling clock's handler: %d", dev);
 
-    if (counts % 5 == 0)
-    {
-        (void)MboxCondSend(device_mbox_ID[CLOCK_DEV], NULL, 0);
-        counts = 0;
-    }
+    notify = (counts == 0);
+    counts = (counts + 1) % 5;
+
+    timers_expire();
+
+    if (!clock_waiters() && !timers_pending() && skip_tick())
+        return;
+
+    if (notify)
+        (void)MboxCondSend(device_mbox_ID[DEVICE_INDEX(CLOCK_DEV, 0)], NULL, 0);
 
-    ++counts;
     time_slice();
 }
 
@@ -61,7 +76,7 @@ disk_handler(int dev, int unit)
 
     device_input(DISK_DEV, unit, &status_reg);
 
-    (void)MboxCondSend(device_mbox_ID[DISK_DEV + unit],
+    (void)MboxCondSend(device_mbox_ID[DEVICE_INDEX(DISK_DEV, unit)],
                        &status_reg,
                        sizeof(status_reg));
 }
@@ -85,14 +100,31 @@ term_handler(int dev, int unit)
     device_input(TERM_DEV, unit, &status_reg);
     DP2(DEBUG3, "Status value == %02x (%d)\n", status_reg, status_reg);
 
-    (void)MboxCondSend(device_mbox_ID[TERM_DEV + unit],
+    (void)MboxCondSend(device_mbox_ID[DEVICE_INDEX(TERM_DEV, unit)],
                        &status_reg,
                        sizeof(status_reg));
 }
 
+/*!
+    Pass a syscall on to its entry in sys_vec.  The sysargs come from
+    usyscall_args() rather than 'unit', which can't hold a pointer on a
+    64-bit host.
+*/
+
 void
 syscall_handler(int dev, int unit)
 {
+    sysargs *args = usyscall_args();
+
     DP2(DEBUG3, "syscall_handler(): handler called\n");
+
+    if (dev != SYS_INT)
+        KERNEL_ERROR("non-syscall device calling syscall's handler: %d", dev);
+    if (!args)
+        KERNEL_ERROR("NULL sysargs");
+    if ((args->number < 0) || (args->number >= MAXSYSCALLS))
+        KERNEL_ERROR("Invalid syscall number %d", args->number);
+
+    sys_vec[args->number](args);
 }
 
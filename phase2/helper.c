@@ -1,115 +1,121 @@
 #include "helper.h"
 #include "utility.h"
 #include "handler.h"
+#include "timer.h"
 
 #include <phase2.h>
 #include <phase1.h>
+#include <stdlib.h>
 #include <string.h>
 
 /******************************************************************************/
 /* Global Variables                                                           */
 /******************************************************************************/
 
-extern int next_box_ID;
 extern int slots_in_use;
 extern int boxes_in_use;
 extern mail_box MailBoxTable[];
-extern mail_slot message_slots[];
+extern mailbox *free_boxes_front;
+extern mailbox *free_boxes_back;
+extern long long message_slab[];
+extern mail_slot *free_slots[];
+
+/* Bytes of message each size class holds, and how many slots it has */
+static const int slot_sizes[SLOT_CLASSES] = { 0, 8, 32, MAX_MESSAGE };
+static const int slot_counts[SLOT_CLASSES] =
+    { SLOTS_0, SLOTS_8, SLOTS_32, SLOTS_150 };
+
+/* Biggest class slots from malloc() now in use: see get_free_slot() */
+static int heap_slots;
+
+#define IN_SLAB(slot) \
+    (   ((byte_t *)(slot) >= (byte_t *)message_slab) \
+     && ((byte_t *)(slot) < (byte_t *)message_slab + SLAB_BYTES))
 extern int device_mbox_ID[];
 extern proc_entry process_table[];
+extern select_info select_table[];
 extern void (*sys_vec[])(sysargs *args);
 
 extern int debugflag2;
 
-/*
-    Assuming MAXMBOX < MAXINT, then there should always be a free ID
-    somewhere, but it's possible that if there's a lot of mailbox churn,
-    but also a stable mailbox used by long-lasting process, then we could
-    wrap around the list and try to use the same ID twice.  This should
-    prevent that.
+/*!
+    Returns the ID for a new mailbox at MailBoxTable 'position', and
+    moves the position on to its next generation.  See ID_TO_POSITION().
 */
 
 int
-get_next_ID(void)
+get_next_ID(int position)
 {
-    int i;
-    int potential = next_box_ID;
-
-    /* do not want a mbox with this certain ID: use it to identify
-       empty table slots */
-    potential += potential == EMPTY_BOX_ID;
-
-    do 
-    {
-        for ( i = 0; i < MAXMBOX; ++i)
-            /* check for dupe.  If dupe, then must try next possible ID */
-            if (MailBoxTable[i].mbox_ID == potential)
-                break;
-
-        /* If dupe, try next ID. */
-        if (i < MAXMBOX)
-            ++potential;
-
-      /* Stop when (a) have made it through entire list with no matches (GOOD)
-         (b) have completely wrapped around list of IDs (BAD)  */
-    } while ((i < MAXMBOX) && ( (potential + 1) != next_box_ID));
+    mailbox *box = MailBoxTable + position;
+    const int ID = box->generation * MAXMBOX + position;
 
-    if ( (potential + 1) == next_box_ID)
-    {
-        DP2(DEBUG3,"No more mailbox IDs for pid %d", getpid());
-        return -ENOIDS;
-    }
+    box->generation = (box->generation + 1) % BOX_GENERATIONS;
 
-
-    DP2(DEBUG4,"mailbox ID is %d\n", potential);
-    ++next_box_ID;
-    return potential;
+    DP2(DEBUG4,"mailbox ID is %d\n", ID);
+    return ID;
 }
 
 /*!
     Input Invariant: you know that the number of used mailboxes is < number
                      of available mailboxes.
+
+    Takes the mailbox released longest ago off the free list, so that a
+    position's generation (and so its IDs) moves as slowly as it can.
 */
 
 int
 find_empty_mailbox(void)
 {
-    int i = 0;
-    for ( ; i < MAXMBOX; ++i)
-        if (MailBoxTable[i].mbox_ID == EMPTY_BOX_ID)
-            break;
+    mailbox *box = free_boxes_front;
 
-    if (i == MAXMBOX)
+    if (!box)
         KERNEL_ERROR("Hey, no empty mailbox found!  Failed invariant.");
 
-    DP2(DEBUG3, "found an unused mailbox at position %d", i);
-    return i;
+    free_boxes_front = box->next_free;
+    if (!free_boxes_front)
+        free_boxes_back = NULL;
+    box->next_free = NULL;
+
+    DP2(DEBUG3, "found an unused mailbox at position %d", box - MailBoxTable);
+    return box - MailBoxTable;
+}
+
+/*!
+    Put unused mailbox 'box' on the back of the free list.
+*/
+
+void
+add_to_free_boxes(mailbox *box)
+{
+    box->next_free = NULL;
+    if (free_boxes_back)
+        free_boxes_back->next_free = box;
+    else
+        free_boxes_front = box;
+    free_boxes_back = box;
 }
 
 /*!
     Given a mailbox ID, returns 0 if a mailbox with that ID is found,
     or -EBADBOX if it is not.  If there is a valid mailbox, then position
     will be assigned the index value within MailBoxTable where the mailbox
-    may be found.
+    may be found: the ID says where to look (see ID_TO_POSITION()).
 */
 
 int
 is_valid_mailbox(int ID, int *position)
 {
-    int i = 0;
+    const int i = ID_TO_POSITION(ID);
     int status;
 
-    for ( ; i < MAXMBOX; ++i)
-        if (MailBoxTable[i].mbox_ID == ID)
-            break;
-
-    if ((i < MAXMBOX) && position)
-        *position = i;
-
-    if (i == MAXMBOX)
+    if ((ID < 0) || (MailBoxTable[i].mbox_ID != ID))
         status = -EBADBOX;
     else
+    {
         status = 0;
+        if (position)
+            *position = i;
+    }
 
     DP2(DEBUG, "box ID %d is %s: position is %d -- returning %d\n",
         ID, ((status == 0) ? "valid" : "invalid"), i, status);
@@ -120,9 +126,12 @@ is_valid_mailbox(int ID, int *position)
 /*!
     Given a mailbox 'box', checks to see if the mailbox still is
     allowed another slot.  If so, then checks to see if there are any
-    slots free.  If yes, then starting from the beginning of the list of
-    mail slots, finds the 1st slot that has a 0 mbox_ID (is unused), and
-    returns a pointer to it.
+    slots free that hold 'msg_size' bytes.  If yes, then takes the
+    smallest such slot off the top of its free list and returns a
+    pointer to it: the caller must either put it in the box or give it
+    back with free_slot().  If the slab has nothing left that's big
+    enough, a slot of the biggest class comes from malloc() instead,
+    as long as there are fewer than SLOTS_HEAP_MAX of those.
 
     If the mailbox has no free slots available, then NULL is returned.
 
@@ -131,9 +140,10 @@ is_valid_mailbox(int ID, int *position)
 */
 
 mail_slot *
-get_free_slot(mailbox *box)
+get_free_slot(mailbox *box, int msg_size)
 {
-    int i = 0;
+    mail_slot *slot;
+    int size_class = smallest_slot_class(msg_size);
 
     if (!box)
         KERNEL_ERROR("NULL mailbox");
@@ -144,18 +154,86 @@ get_free_slot(mailbox *box)
         return NULL;
     }
 
-    if (slots_in_use == MAXSLOTS)
+    while ((size_class < SLOT_CLASSES) && !free_slots[size_class])
+        ++size_class;
+
+    if (size_class < SLOT_CLASSES)
+    {
+        slot = free_slots[size_class];
+        free_slots[size_class] = slot->next;
+    }
+    else if (heap_slots < SLOTS_HEAP_MAX)
+    {
+        size_class = SLOT_CLASSES - 1;
+        slot = (mail_slot *)malloc(SLOT_STRIDE(MAX_MESSAGE));
+        if (!slot)
+            KERNEL_ERROR("No memory for a message slot");
+        initialize_slot(slot);
+        slot->size_class = size_class;
+        ++heap_slots;
+    }
+    else
         KERNEL_ERROR("No free message slots available");
 
-    for ( ; i < MAXSLOTS; ++i)
-        if (message_slots[i].mbox_ID == EMPTY_BOX_ID)
-            break;
+    slot->next = NULL;
+    ++slots_in_use;
+
+    DP2(DEBUG, "Found a free slot of %d bytes\n", slot_sizes[size_class]);
+    return slot;
+}
+
+/*!
+    The smallest size class whose slots hold 'msg_size' bytes.  Sizes
+    too big for any are left for the caller to reject: they get the
+    biggest class.
+*/
+
+int
+smallest_slot_class(int msg_size)
+{
+    int size_class = 0;
+
+    while ((size_class < SLOT_CLASSES - 1) && (msg_size > slot_sizes[size_class]))
+        ++size_class;
+    return size_class;
+}
+
+/*!
+    Returns 1 if there's a free slot that holds 'msg_size' bytes, else 0.
+*/
+
+int
+slot_available(int msg_size)
+{
+    int size_class = smallest_slot_class(msg_size);
+
+    for ( ; size_class < SLOT_CLASSES; ++size_class)
+        if (free_slots[size_class])
+            return 1;
+    return heap_slots < SLOTS_HEAP_MAX;
+}
+
+/*!
+    Slot 'slot' isn't used for a message any more: clear it and put it
+    on top of its class's free list, or if it came from the heap, give
+    it back.
+*/
+
+void
+free_slot(mail_slot *slot)
+{
+    --slots_in_use;
 
-    if (i == MAXSLOTS)
-        KERNEL_ERROR("Accounting misfortune finding a free slot");
+    if (!IN_SLAB(slot))
+    {
+        free(slot);
+        --heap_slots;
+        return;
+    }
 
-    DP2(DEBUG, "Found a free slot\n");
-    return &message_slots[i];
+    initialize_slot(slot);
+    slot->next = free_slots[slot->size_class];
+    free_slots[slot->size_class] = slot;
 }
 
 /*!
@@ -172,12 +250,15 @@ get_next_slot(mailbox *box)
 }
 
 /*!
-    Removes the first message in the message queue and advances to next message.
+    Removes the first message in the message queue and advances to next
+    message.  Returns the message's slot, which the caller either reuses
+    or gives back with free_slot().
 
-    For a 0 slot box, the routine simply returns without doing anything.
+    For a 0 slot box, the routine simply returns NULL without doing
+    anything.
 */
 
-void
+mail_slot *
 release_slot(mailbox *box)
 {
     mail_slot *s;
@@ -189,7 +270,7 @@ release_slot(mailbox *box)
     {
         /* This is the path a 0 slot mailbox will take */
         DP2(DEBUG2, "Message queue already empty");
-        return;
+        return NULL;
     }
 
     s = box->slots_front;
@@ -198,13 +279,12 @@ release_slot(mailbox *box)
     if (box->slots_front == NULL)
         box->slots_back = NULL;
 
-    --slots_in_use; 
     --box->slots_count;
-    initialize_slot(s);
 
     DP2(DEBUG2, "Box %d has freed a slot, now using %d of %d\n",
         box->mbox_ID, box->slots_count, box->max_slots_count);
 
+    return s;
 }
 
 /*!
@@ -232,7 +312,6 @@ add_to_slot_list(mailbox *box, mail_slot *slot)
         slot->next = NULL;
     }
 
-    ++slots_in_use;
     ++box->slots_count;
 
 }
@@ -267,33 +346,73 @@ handle_message_copy(mailbox *box, mail_slot *slot, void *msg_ptr, int msg_size)
 
 /*
     A slot freed up by an MboxReceive might be immediately used up
-    again if any senders were blocked.
+    again if any senders were blocked.  'spare' is that slot: if the
+    first blocked sender's message fits in it, it's used again as it
+    is, rather than being freed and another taken.
 */
 
 void
-handle_pending_senders(mailbox *box)
+handle_pending_senders(mailbox *box, mail_slot *spare)
 {
     mail_slot *s;
 
     if (!box)
         KERNEL_ERROR("Null mailbox");
 
-    if (box->front)
+    if (!box->front)
+    {
+        free_slot(spare);
+        return;
+    }
+
+    DP2(DEBUG, "Reusing slot for queued message\n");
+
+    if (smallest_slot_class(box->front->msg_size) <= spare->size_class)
+        s = spare;
+    else
     {
-        DP2(DEBUG, "Reusing slot for queued message\n");
-    
+        free_slot(spare);
+
         /* Darned well better succeed since we just emptied a slot and
            interrupts are disabled */
-        s = get_free_slot(box);
+        s = get_free_slot(box, box->front->msg_size);
         if (!s)
             KERNEL_ERROR("Shifting pid %d from queue to empty slot",
                          box->front->pid);
+    }
+
+    /* Must handle copy now, before process we're depending upon
+       does anything wacky.  Use handles to message within process_entry of
+       process on queue to move message data to the slot.  Add that slot
+       to list associated with this mailbox. */
+    handle_message_copy(box, s, box->front->msg_ptr, box->front->msg_size);
+
+    /* It's the queued sender's message, not ours */
+    s->pid = box->front->pid;
+}
+
+/*!
+    For mailboxes with priority inheritance on (MboxInherit()): the
+    senders still blocked on 'box' lend their priority to whoever sent
+    the oldest message in it, which may have just changed.  For a
+    mutex, that's the process holding it.
+
+    Enables interrupts on the way through: returns with them disabled.
+*/
 
-        /* Must handle copy now, before process we're depending upon
-           does anything wacky.  Use handles to message within process_entry of
-           process on queue to move message data to the newly acquired slot. Add
-           that slot to list associated with this mailbox. */
-        handle_message_copy(box, s, box->front->msg_ptr, box->front->msg_size);
+void
+lend_to_slot_holder(mailbox *box)
+{
+    proc_entry *p;
+    const int holder = box->slots_front ? box->slots_front->pid : 0;
+
+    for (p = box->front; p; p = p->next)
+    {
+        if (p->type != PROCESS_SENDER)
+            continue;
+
+        (void)lend_priority(p->pid, holder, box->mbox_ID);
+        disableInterrupts();
     }
 }
 
@@ -307,7 +426,7 @@ initialize_slot(mail_slot *slot)
     if (!slot)
         KERNEL_ERROR("Mailslot is NULL");
 
-    DP2(DEBUG3, "Init slot %d\n", slot - message_slots);
+    DP2(DEBUG3, "Init slot %p\n", slot);
 
     slot->next = NULL;
     slot->mbox_ID = EMPTY_BOX_ID;
@@ -335,6 +454,8 @@ use_mailbox(mailbox *box, int box_ID, int slots, int slot_size)
     box->slots_back = NULL;
     box->front = NULL;
     box->back = NULL;
+    box->inherit = 0;
+    box->device = 0;
     ++boxes_in_use;
     DP2(DEBUG2, "Box %d initialized to %d slots of max message size %d\n",
         box_ID, slots, slot_size);
@@ -366,6 +487,10 @@ initialize_mailbox(mailbox *box)
     box->back = NULL;
     box->slots_front = NULL;
     box->slots_back = NULL;
+    box->inherit = 0;
+    box->device = 0;
+    box->generation = 0;
+    box->next_free = NULL;
 }
 
 
@@ -391,6 +516,8 @@ reinitialize_mailbox(mailbox *box)
     box->slots_count = 0;
     box->front = NULL;
     box->back = NULL;
+    box->inherit = 0;
+    box->device = 0;
 
     slot = box->slots_front;
     if (slot)
@@ -398,10 +525,11 @@ reinitialize_mailbox(mailbox *box)
         do {
             previous = slot;
             slot = slot->next;
-            initialize_slot(previous);
+            free_slot(previous);
         } while (slot);
     }
     --boxes_in_use;
+    add_to_free_boxes(box);
 }
 
 /*!
@@ -511,9 +639,65 @@ dequeue(mailbox *box, const enum process_type type)
         p->pid, box->mbox_ID);
 
     p->next = NULL;
+
+    /* An MboxSelect()er is getting this box's message: not the others' */
+    if (p->select)
+        select_cancel(p);
+
     return p;
 }
 
+/*!
+    Take 'p' off mailbox 'box's queue, wherever it is in it.  Returns 1
+    if it was there, else 0.
+*/
+
+int
+remove_from_queue(mailbox *box, proc_entry *p)
+{
+    proc_entry *previous = NULL;
+    proc_entry *q = box->front;
+
+    for ( ; q && (q != p); q = q->next)
+        previous = q;
+    if (!q)
+        return 0;
+
+    if (previous)
+        previous->next = p->next;
+    else
+        box->front = p->next;
+    if (box->back == p)
+        box->back = previous;
+    p->next = NULL;
+    return 1;
+}
+
+/*!
+    'p', one of an MboxSelect()ing process's entries, is done waiting:
+    it's been handed a message, or its mailbox was released.  Take the
+    process's other entries off their mailboxes' queues before anything
+    else can be handed to them.
+*/
+
+void
+select_cancel(proc_entry *p)
+{
+    select_info *sel = p->select;
+    int i = 0;
+
+    if (!sel->count)
+        return;
+
+    for ( ; i < sel->count; ++i)
+        if (sel->entries + i != p)
+            remove_from_queue(MailBoxTable + ID_TO_POSITION(sel->box_IDs[i]),
+                              sel->entries + i);
+
+    sel->ready = p - sel->entries;
+    sel->count = 0;
+}
+
 /*!
     Returns with interrupts DISABLED.
 
@@ -521,8 +705,12 @@ dequeue(mailbox *box, const enum process_type type)
     released while we are blocked: we won't then be able to check and see
     if the box ID we had was valid.
 
+    An MboxSendTimed() or MboxReceiveTimed() caller's timer (see
+    timer.c) runs while it's blocked.
+
     Returns 0 if everything okay
             -EZAPPED if the process was zapped while blocked
+            -ETIMEDOUT if its timer ran out first
             -EBOXRELEASED if the mailbox it is attached to is released
 */
 
@@ -535,8 +723,7 @@ handle_enqueue_and_blocking
     const enum process_type type
 )
 {
-    #define MAGICAL_OFFSET 50
-    int status;
+    int status = 0, timed_out;
     int box_ID = box->mbox_ID;
 
     if (!box)
@@ -547,15 +734,23 @@ handle_enqueue_and_blocking
     DP2(DEBUG2, "Blocking process %d on box %d\n", getpid(), box->mbox_ID);
 
     enqueue(box, &process_table[CURRENT]);
-    /* interrupts are enabled in block_me(): returns 0 on success */
-    status = block_me( (int)type + MAGICAL_OFFSET);
-    if (status != 0)
-        KERNEL_ERROR("Error blocking process %d\n", getpid());
-    disableInterrupts();                         
+
+    /* Senders wait on whoever filled the box up */
+    if ((type == PROCESS_SENDER) && box->inherit && box->slots_front)
+    {
+        (void)lend_priority(getpid(), box->slots_front->pid, box->mbox_ID);
+        disableInterrupts();
+    }
+
+    timer_start(box, &process_table[CURRENT]);
+    block_on_mailbox(type, box->device);
+    timed_out = timer_stop();
 
     /* See if zapped while blocked */
     if (is_zapped())
         status = -EZAPPED;         
+    else if (timed_out)
+        status = -ETIMEDOUT;
     /* See if mailbox released while blocked */
     else if (is_valid_mailbox(box_ID, 0) == -EBADBOX)
         status = -EBOXRELEASED;
@@ -563,6 +758,84 @@ handle_enqueue_and_blocking
     return status;
 }
 
+/*!
+    handle_enqueue_and_blocking() for MboxSelect(): wait on all 'count'
+    mailboxes in 'box_IDs' (checked by the caller) at once, as a
+    receiver of up to 'msg_size' bytes at 'msg_ptr'.
+
+    Returns with interrupts DISABLED.
+
+    Returns the index in 'box_IDs' of the mailbox whose message we got
+            -EZAPPED if the process was zapped while blocked
+            -EBOXRELEASED if the mailbox that woke us was released
+*/
+
+int
+handle_select_and_blocking
+(
+    int box_IDs[],
+    int count,
+    void *msg_ptr,
+    int msg_size
+)
+{
+    select_info *sel = select_table + CURRENT;
+    mailbox *box;
+    proc_entry *p;
+    int i = 0, device = 0;
+
+    for ( ; i < count; ++i)
+    {
+        box = MailBoxTable + ID_TO_POSITION(box_IDs[i]);
+        p = sel->entries + i;
+
+        p->msg_ptr = msg_ptr;
+        p->msg_size = msg_size;
+        p->type = PROCESS_RECEIVER;
+        p->select = sel;
+        sel->box_IDs[i] = box_IDs[i];
+
+        DP2(DEBUG2, "Selecting process %d on box %d\n", getpid(), box_IDs[i]);
+        enqueue(box, p);
+        device |= box->device;
+    }
+    sel->count = count;
+    sel->ready = -1;
+
+    block_on_mailbox(PROCESS_RECEIVER, device);
+
+    if (sel->count)
+        KERNEL_ERROR("Process %d woken with no mailbox ready", getpid());
+
+    /* See if zapped while blocked */
+    if (is_zapped())
+        return -EZAPPED;
+    /* See if mailbox released while blocked */
+    if (is_valid_mailbox(sel->box_IDs[sel->ready], 0) == -EBADBOX)
+        return -EBOXRELEASED;
+
+    return sel->ready;
+}
+
+/*!
+    Block the current process, already on a mailbox queue as a 'type',
+    until it's taken off again.  'device' if that's waiting on a device.
+
+    Returns with interrupts DISABLED.
+*/
+
+void
+block_on_mailbox(const enum process_type type, int device)
+{
+    /* interrupts are enabled in block_me(): returns 0 on success.  The
+     * code tells phase 1 what we're waiting on, for its statistics.
+     * Being zapped while blocked is for the caller to notice. */
+    if (   block_me((int)type + (device ? DEVICE_BLOCK_CODE : MBOX_BLOCK_CODE))
+        && !is_zapped())
+        KERNEL_ERROR("Error blocking process %d\n", getpid());
+    disableInterrupts();
+}
+
 /*!
     Called at startup to initialize interrupt vectors for the
     various "hardware" interrupts supported by the OS.
@@ -586,6 +859,21 @@ init_vectors(void)
     int_vec[SYS_INT]    = syscall_handler;
 }
 
+/*!
+    Waiting on mailbox 'box_ID' is waiting on a device: see
+    handle_enqueue_and_blocking().
+*/
+
+static void
+mark_device_mailbox(int box_ID)
+{
+    int position;
+
+    if (is_valid_mailbox(box_ID, &position))
+        KERNEL_ERROR("Device mailbox %d doesn't exist", box_ID);
+    MailBoxTable[position].device = 1;
+}
+
 /*!
     Handles setting up all the 0 slot mailboxes use for
     synchronization of the devices.
@@ -605,7 +893,8 @@ init_device_mailboxes(void)
     status = MboxCreate(0, MAX_MESSAGE);
     if (status < 0)
         KERNEL_ERROR("Creating mailbox for the clock device");
-    device_mbox_ID[CLOCK_DEV] = status;
+    device_mbox_ID[DEVICE_INDEX(CLOCK_DEV, 0)] = status;
+    mark_device_mailbox(status);
 
     /* mailbox for the disk devices */
     for (i = 0 ; i < DISK_UNITS; ++i)
@@ -613,7 +902,8 @@ init_device_mailboxes(void)
         status = MboxCreate(0, MAX_MESSAGE);
         if (status < 0)
             KERNEL_ERROR("Creating mailbox for disk %d device", i);
-        device_mbox_ID[DISK_DEV + i] = status;
+        device_mbox_ID[DEVICE_INDEX(DISK_DEV, i)] = status;
+        mark_device_mailbox(status);
     }
 
     /* mailbox for the term 1 device */
@@ -622,7 +912,8 @@ init_device_mailboxes(void)
         status = MboxCreate(0, MAX_MESSAGE);
         if (status < 0)
             KERNEL_ERROR("Creating mailbox for  term %d device", i);
-        device_mbox_ID[TERM_DEV + i] = status;
+        device_mbox_ID[DEVICE_INDEX(TERM_DEV, i)] = status;
+        mark_device_mailbox(status);
     }
 
     DP2(DEBUG3, "Finished initializing device handler mailboxes.\n");
@@ -636,6 +927,7 @@ initialize_proc_entry(proc_entry *p)
     p->msg_ptr = NULL;
     p->msg_size = 0; 
     p->type = PROCESS_INVALID;
+    p->select = NULL;
 }
 
 void
@@ -654,39 +946,80 @@ void
 initialize_mailbox_table(void)
 {
     int i = 0;
+
+    free_boxes_front = NULL;
+    free_boxes_back = NULL;
     for ( ; i < MAXMBOX; ++i)
+    {
         initialize_mailbox(MailBoxTable + i);
+        add_to_free_boxes(MailBoxTable + i);
+    }
 }
 
 void
 initialize_slot_table(void)
 {
-    int i = 0;
-    for ( ; i < MAXSLOTS; ++i)
-        initialize_slot(message_slots + i);
+    byte_t *next = (byte_t *)message_slab;
+    mail_slot *slot;
+    int size_class = 0;
+    int i;
+
+    /* Carve up the slab: each class's slots are SLOT_STRIDE() apart */
+    for ( ; size_class < SLOT_CLASSES; ++size_class)
+    {
+        free_slots[size_class] = NULL;
+        for (i = 0; i < slot_counts[size_class]; ++i)
+        {
+            slot = (mail_slot *)next;
+            next += SLOT_STRIDE(slot_sizes[size_class]);
+
+            initialize_slot(slot);
+            slot->size_class = size_class;
+            slot->next = free_slots[size_class];
+            free_slots[size_class] = slot;
+        }
+    }
+    slots_in_use = 0;
+    heap_slots = 0;
 }
 
 /*!
-    Returns 1 if there is a device is blocked on its device mailbox, else 0.
+    Returns 1 if there is a device is blocked on its device mailbox, or
+    anyone is waiting with a deadline (the clock will wake them), else 0.
 
-    Note that all the fields of the non-initialized devices
-    (ALARM_DEV), etc. are set to 0 (NULL) because the array is global
-    (well, of static duration), so these comparisons should be safe.
+    Only the clock, disks and terminals have mailboxes, but every unit
+    of them counts.
 */
 
+#define DEVICE_WAITERS(type, unit) \
+    (MailBoxTable[ID_TO_POSITION(device_mbox_ID[DEVICE_INDEX(type, unit)])].front != NULL)
+
 int
 check_io(void)
 {
     int status = 0;
-    status += MailBoxTable[device_mbox_ID[CLOCK_DEV]].front != NULL;    
-    status += MailBoxTable[device_mbox_ID[ALARM_DEV]].front != NULL;    
-    status += MailBoxTable[device_mbox_ID[DISK_DEV]].front != NULL;    
-    status += MailBoxTable[device_mbox_ID[TERM_DEV]].front != NULL;    
-    status += MailBoxTable[device_mbox_ID[MMU_INT]].front != NULL;    
-    status += MailBoxTable[device_mbox_ID[SYS_INT]].front != NULL;    
+    int i;
+
+    status += DEVICE_WAITERS(CLOCK_DEV, 0);
+    for (i = 0; i < DISK_UNITS; ++i)
+        status += DEVICE_WAITERS(DISK_DEV, i);
+    for (i = 0; i < TERM_UNITS; ++i)
+        status += DEVICE_WAITERS(TERM_DEV, i);
+    status += timers_pending();
     return status ? 1 : 0;
 }
 
+/*!
+    Returns 1 if anyone is blocked on the clock device mailbox, e.g. a
+    sleeper waiting for its time to come up, else 0.
+*/
+
+int
+clock_waiters(void)
+{
+    return DEVICE_WAITERS(CLOCK_DEV, 0);
+}
+
 /*!
     Handles messages directed at mail boxes for which there are no slots.
 */
@@ -728,20 +1061,128 @@ slotless_sender(mailbox *box, void *msg_ptr, int msg_size)
     return status;
 }
 
+/*!
+    The part of MboxSend() after the mailbox ID has been checked: also
+    used for each message of MboxSendMany().
+*/
+
+int
+send_message(mailbox *box, void *msg_ptr, int msg_size)
+{
+    /* Okay, I think I finally got this.  NULL pointers are okay as
+       long as the message size is 0*/
+    if (!msg_ptr && (msg_size != 0))
+    {
+        DP2(DEBUG, "Null message pointer to mailbox %d\n", box->mbox_ID);
+        return -ENULLMSG;
+    }
+
+    if ((msg_size > box->max_message_size) || (msg_size < 0))
+    {
+        DP2(DEBUG, "Invalid message size of %d to box %d\n",
+            msg_size, box->mbox_ID);
+        return -EMSGSIZE;
+    }
+
+    TRACE_EVENT(TRACE_SEND, box->mbox_ID, msg_size);
+
+    if (box->max_slots_count == 0)
+        /* 0 slot mailbox special case */
+        return slotless_sender(box, msg_ptr, msg_size);
+    return slotful_sender(box, msg_ptr, msg_size);
+}
+
+/*!
+    The part of MboxReceive() after the mailbox ID has been checked:
+    also used for each message of MboxReceiveMany().
+*/
+
+int
+receive_message(mailbox *box, void *msg_ptr, int msg_size)
+{
+    int status;
+    mail_slot *slot;
+
+    // 0 slot mailboxes can have null message pointers.  Who knew?
+    if ((box->max_slots_count != 0) && !msg_ptr)
+    {
+        DP2(DEBUG, "Null message pointer getting from mailbox %d\n",
+            box->mbox_ID);
+        return -ENULLMSG;
+    }
+
+    // Sun Feb 20 14:35:47 MST 2005
+    //
+    // test case 03 makes it appear that sending in msg_size >
+    //max_message_size supported by the box is okay
+
+    //if ((msg_size > box->max_message_size) || (msg_size < 0))
+    if ((msg_size > MAX_MESSAGE) || (msg_size < 0))
+    {
+        DP2(DEBUG, "Invalid max message size of %d getting from box %d\n",
+            msg_size, box->mbox_ID);
+        return -EMSGSIZE;
+    }
+
+    /* Get message on front of queue for this mailbox: block if Null */
+    slot = get_next_slot(box);
+
+    if (slot && box->max_slots_count == 0)
+        KERNEL_ERROR("Had a slot for a 0 slot mailbox");
+
+    if (box->max_slots_count == 0)
+        status = slotless_receive(box, msg_ptr, msg_size);
+    else 
+        status = slotful_receive(box, slot, msg_ptr, msg_size);
+
+    TRACE_EVENT(TRACE_RECEIVE, box->mbox_ID, status);
+    return status;
+}
+
+/*!
+    Is there a message 'box' could give a receiver without blocking?
+*/
+
+int
+message_waiting(mailbox *box)
+{
+    if (box->max_slots_count == 0)
+        return box->front && (box->front->type == PROCESS_SENDER);
+    return box->slots_count > 0;
+}
+
 /*!
     Sends messages in the case that the mailbox to which messages are
-    directed has slots (free or occupied: as long as they exist 
+    directed has slots (free or occupied: as long as they exist).
+
+    A receiver already waiting on the box gets the message copied
+    straight to it: no slot is taken, so a full slot pool doesn't
+    matter, and the message isn't copied twice.
 */
 
 int
-slotful_sender(mailbox *box, mail_slot *slot, void *msg_ptr, int msg_size)
+slotful_sender(mailbox *box, void *msg_ptr, int msg_size)
 {
     int status = 0, message_size;
+    mail_slot *slot;
 
     DP2(DEBUG, "Slotful sender\n");
 
-    /* There are slots for this mailbox, but they may all be full */
-    if (!slot)
+    if (box->front && box->front->type == PROCESS_RECEIVER)
+    {
+        DP2(DEBUG, "Sender to queue with receiver blocked: copying "
+                   "to receiver directly\n");
+
+        message_size = MIN(msg_size, box->front->msg_size);
+        memcpy(box->front->msg_ptr, msg_ptr, message_size);
+        box->front->msg_size = message_size;
+        DP2(DEBUG, "Copied %d bytes to receiver\n", box->front->msg_size);
+        release_process(box, PROCESS_RECEIVER);
+    }
+    else if ((slot = get_free_slot(box, msg_size)))
+        /* no queued up receivers: put data in slot */
+        handle_message_copy(box, slot, msg_ptr, msg_size);
+    else
     {
         /* All slots full */
         DP2(DEBUG, "No slot for %d in %d, so blocking and looping\n",
@@ -749,35 +1190,7 @@ slotful_sender(mailbox *box, mail_slot *slot, void *msg_ptr, int msg_size)
 
         status = handle_enqueue_and_blocking(box, msg_ptr, msg_size,
                                              PROCESS_SENDER);
-/*
-        if (status == 0)
-            CLEAR_PROC_INFO;
-*/
         /* non-zero status: zapped or mailbox released while blocked */
-    } else
-    {
-        /* Non-blocking side */
-
-        /* Got a free slot in a slotful mailbox: are there receivers pending? */
-        if (box->front)
-        {
-            DP2(DEBUG, "Sender to queue with receiver blocked: copying "    
-                       "to receiver directly\n");
-
-            /* Didn't need slot after all: receivers are pending and I      
-               must copy data directly to their msg_ptrs. Thankfully,
-               we've not done anything with the slot, so we'll pretend
-               we just never heard of it. */
-
-            message_size = MIN(msg_size, box->front->msg_size);
-            memcpy(box->front->msg_ptr, msg_ptr, message_size);
-            box->front->msg_size = message_size;
-            DP2(DEBUG, "Copied %d bytes to receiver: first few are %08x\n", 
-                       box->front->msg_size, *(int *)box->front->msg_ptr);
-            release_process(box, PROCESS_RECEIVER);
-        } else
-            /* no queued up receivers: put data in slot */
-            handle_message_copy(box, slot, msg_ptr, msg_size);
     }
 
     DP2(DEBUG, "Exiting with status %d\n", status);
@@ -815,18 +1228,19 @@ slotless_receive(mailbox *box,  void *msg_ptr, int msg_size)
 
     } else if (box->front->type == PROCESS_SENDER)
     {
-        /* Something is waiting: we needn't block */
-        if (!box->front->msg_ptr)
+        /* Something is waiting: we needn't block.  A 0 byte message
+           (a phase 3 semaphore's P) can come from NULL. */
+        if (!box->front->msg_ptr && box->front->msg_size)
             KERNEL_ERROR("Source pointer is NULL for 0 slot mailbox");
 
-            /* 0 slot process: move from sender's msg_ptr directly to ours. */
-            /* It's okay to do a 0 byte memcpy to a NULL ptr, so I needn't
-               stress on that. */
-            message_size = MIN(msg_size, box->front->msg_size);
-            memcpy(msg_ptr, box->front->msg_ptr, message_size);
-            status = message_size;
-            box->front->msg_size = message_size;
-            release_process(box, PROCESS_SENDER);
+        /* 0 slot process: move from sender's msg_ptr directly to ours. */
+        /* It's okay to do a 0 byte memcpy to a NULL ptr, so I needn't
+           stress on that. */
+        message_size = MIN(msg_size, box->front->msg_size);
+        memcpy(msg_ptr, box->front->msg_ptr, message_size);
+        status = message_size;
+        box->front->msg_size = message_size;
+        release_process(box, PROCESS_SENDER);
     } else
         KERNEL_ERROR("Bad or unknown process type for pid %d '%d'",
                      getpid(), box->front->type);
@@ -868,9 +1282,10 @@ slotful_receive(mailbox *box, mail_slot *slot, void *msg_ptr, int msg_size)
             DP2(DEBUG, "After copy, %d bytes '%s'\n",
                 slot->bytes, (char *)msg_ptr);
             status = slot->bytes;
-            release_slot(box);
-            handle_pending_senders(box);
+            handle_pending_senders(box, release_slot(box));
             release_process(box, PROCESS_SENDER);
+            if (box->inherit)
+                lend_to_slot_holder(box);
         }
         else
             status = -ESLOTSIZE;
@@ -892,8 +1307,9 @@ release_process(mailbox *box, const enum process_type type)
     p = dequeue(box, type);
     if (p)
     {
+        /* A zapped caller still wakes 'p': see unblock_proc() */
         ret = unblock_proc(p->pid);
-        if (ret != 0)
+        if ((ret != 0) && !is_zapped())
             KERNEL_ERROR("Failed to unblock %d (supposedly a blocked '%s'): "
                          "return code was %d\n",
                          p->pid,
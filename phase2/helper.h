@@ -3,6 +3,8 @@
 
 #include "message.h"
 
+#include <limits.h>     /* INT_MAX */
+
 #define ENOIDS  1
 #define ENOBOX 1
 #define ESLOTSIZE 1
@@ -17,33 +19,57 @@
 #define EZAPPED 3
 #define EBOXRELEASED 3
 
+#define ETIMEDOUT 4
+
 #define RECEIVER 1
 #define SENDER 2
 #define EITHER 4
 
 #define EMPTY_BOX_ID -1
 
+/* A mailbox ID is its position in MailBoxTable plus MAXMBOX times that
+ * position's generation, which goes up each time the position is
+ * reused.  Finding a box is then a modulus, and an ID left over from a
+ * released box doesn't match whoever has the position now.  Generations
+ * wrap before IDs would overflow an int. */
+#define ID_TO_POSITION(a) ((a) % MAXMBOX)
+#define BOX_GENERATIONS (INT_MAX / MAXMBOX)
+
+/* Where a device unit's mailbox ID is in device_mbox_ID[]: MAX_UNITS
+ * entries per device type, so that units of different types don't
+ * share one */
+#define DEVICE_INDEX(type, unit) ((type) * MAX_UNITS + (unit))
+
 
 //#define CLEAR_PROC_INFO set_process_entry_info(NULL, 0, PROCESS_INVALID)
 #define CLEAR_PROC_INFO (0)
 
-int get_next_ID(void);
+int get_next_ID(int position);
 int find_empty_mailbox(void);
+void add_to_free_boxes(mailbox *box);
 int is_valid_mailbox(int ID, int *position);
-mail_slot *get_free_slot(mailbox *box);
+mail_slot *get_free_slot(mailbox *box, int msg_size);
+int smallest_slot_class(int msg_size);
+int slot_available(int msg_size);
 mail_slot *get_next_slot(mailbox *box);
-void release_slot(mailbox *box);
+mail_slot *release_slot(mailbox *box);
+void free_slot(mail_slot *slot);
 void add_to_slot_list(mailbox *box, mail_slot *slot);
 void handle_message_copy(mailbox *box, mail_slot *slot, void *msg_ptr, int msg_size);
-void handle_pending_senders(mailbox *box);
+void handle_pending_senders(mailbox *box, mail_slot *spare);
+void lend_to_slot_holder(mailbox *box);
 void initialize_slot(mail_slot *s);
 void use_mailbox(mailbox *box, int box_ID, int slots, int slot_size);
 void initialize_mailbox(mailbox *box);
 void reinitialize_mailbox(mailbox *box);
 void enqueue(mailbox *box, proc_entry *p);
 proc_entry *dequeue(mailbox *box, const enum process_type type);
+int remove_from_queue(mailbox *box, proc_entry *p);
+void select_cancel(proc_entry *p);
 
 int handle_enqueue_and_blocking(mailbox *box, void *msg_ptr, int msg_size, const enum process_type type);
+int handle_select_and_blocking(int box_IDs[], int count, void *msg_ptr, int msg_size);
+void block_on_mailbox(const enum process_type type, int device);
 
 void init_vectors(void);
 void init_device_mailboxes(void);
@@ -58,10 +84,16 @@ void initialize_slot_table(void);
 /* Required by phase 1 code */
 int check_io(void);
 
+int clock_waiters(void);
+
 void release_process(mailbox *box, const enum process_type type);
 
+int send_message(mailbox *box, void *msg_ptr, int msg_size);
+int receive_message(mailbox *box, void *msg_ptr, int msg_size);
+int message_waiting(mailbox *box);
+
 int slotless_sender(mailbox *box, void *msg_ptr, int msg_size);
-int slotful_sender(mailbox *box, mail_slot *slot, void *msg_ptr, int msg_size);
+int slotful_sender(mailbox *box, void *msg_ptr, int msg_size);
 int slotless_receive(mailbox *box, void *msg_ptr, int msg_size);
 int slotful_receive(mailbox *box, mail_slot *slot, void *msg_ptr, int msg_size);
 
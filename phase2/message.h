@@ -6,6 +6,7 @@
 typedef struct _mailbox mailbox;
 typedef struct _mail_slot mail_slot;
 typedef struct _proc_entry proc_entry;
+typedef struct _select_info select_info;
 
 typedef void (*sys_vec_func_t)(sysargs *arg);
 
@@ -14,6 +15,44 @@ typedef mailbox mail_box;
 
 typedef unsigned char byte_t;
 
+/* Message slots come in size classes, carved out of one slab at startup
+ * (see initialize_slot_table()): a message goes in the smallest class
+ * it fits that has a slot free.  How many slots each class gets can be
+ * set with -D.  The defaults take about the 440 KB that MAXSLOTS slots
+ * of MAX_MESSAGE bytes used to, but hold five times as many messages,
+ * since most are semaphore tokens and device status words.  Once the
+ * slab is used up, slots of the biggest class come from malloc() (see
+ * get_free_slot()), up to MAXSLOTS of them in all, so there's still
+ * room for as many terminal lines as ever: that memory is only taken
+ * while those messages are waiting. */
+#define SLOT_CLASSES 4
+
+#ifndef SLOTS_0
+#define SLOTS_0     4800
+#endif
+#ifndef SLOTS_8
+#define SLOTS_8     6500
+#endif
+#ifndef SLOTS_32
+#define SLOTS_32    800
+#endif
+#ifndef SLOTS_150
+#define SLOTS_150   400
+#endif
+
+/* Biggest class slots that can come from the heap */
+#define SLOTS_HEAP_MAX (MAXSLOTS - SLOTS_150)
+
+#define SLOTS_TOTAL (SLOTS_0 + SLOTS_8 + SLOTS_32 + SLOTS_150)
+
+/* Bytes a slot of 'size' bytes takes up in the slab */
+#define SLOT_STRIDE(size) ((sizeof(mail_slot) + (size) + 7) & ~7UL)
+
+#define SLAB_BYTES (  SLOTS_0 * SLOT_STRIDE(0) \
+                    + SLOTS_8 * SLOT_STRIDE(8) \
+                    + SLOTS_32 * SLOT_STRIDE(32) \
+                    + SLOTS_150 * SLOT_STRIDE(MAX_MESSAGE))
+
 /*typedef mbox_proc *mbox_proc_ptr;*/
 
 struct _mailbox
@@ -26,15 +65,24 @@ struct _mailbox
     mail_slot *slots_front, *slots_back;
     /* Queue of either senders or receivers that are blocked */
     proc_entry *front, *back;
+    /* Blocked senders lend their priority to the oldest message's sender */
+    unsigned int inherit;
+    /* One of the device mailboxes: waiting on it is waiting on a device */
+    unsigned int device;
+    /* Times this position has been used: see ID_TO_POSITION() */
+    unsigned int generation;
+    /* Next on the free list, while unused */
+    mailbox *next_free;
 };
 
 struct _mail_slot
 {
-    mail_slot *next;
+    mail_slot *next;    /* in its mailbox, or on the free list */
     int mbox_ID;    /* mailbox this slot is associated with */
     int pid;        /* so we know whom to unblock */
     int bytes;      /* bytes of data in 'data' */
-    byte_t data[MAX_MESSAGE];
+    int size_class; /* which free list it goes back on */
+    byte_t data[];  /* as many bytes as its class has */
 };
 
 enum process_type { PROCESS_SENDER, PROCESS_RECEIVER, PROCESS_EITHER, PROCESS_INVALID };
@@ -46,6 +94,19 @@ struct _proc_entry
     void *msg_ptr;
     int msg_size;
     enum process_type type;
+    /* Set if this is one of an MboxSelect()ing process's entries */
+    select_info *select;
+};
+
+/* A process in MboxSelect() has a receiver entry queued on each of the
+ * mailboxes, rather than its process_table entry on one.  The first to
+ * get a message takes the rest off their queues (see select_cancel()). */
+struct _select_info
+{
+    int count;                      /* entries queued, 0 once one's used */
+    int ready;                      /* index of the entry that was used */
+    int box_IDs[MAX_SELECT];
+    proc_entry entries[MAX_SELECT];
 };
 
 struct psr_bits
@@ -15,6 +15,7 @@
 #include "message.h"
 #include "utility.h"
 #include "helper.h"
+#include "timer.h"
 
 #include <string.h>
 
@@ -33,17 +34,27 @@ int debugflag2 = 0;
 
 proc_entry process_table[MAXPROC];
 
+/* Where each process's MboxSelect() queue entries live */
+select_info select_table[MAXPROC];
+
 /* the mail boxes */
 int boxes_in_use;
 mail_box MailBoxTable[MAXMBOX];
 
-int next_box_ID;
+/* Unused mailboxes, oldest released first */
+mailbox *free_boxes_front;
+mailbox *free_boxes_back;
 
 int slots_in_use;
-mail_slot message_slots[MAXSLOTS];
+
+/* Where the slots live (long long to keep them aligned) */
+long long message_slab[(SLAB_BYTES + 7) / 8];
+
+/* Unused slots of each size class, most recently freed first */
+mail_slot *free_slots[SLOT_CLASSES];
 
 /* Stores the IDs of the mailboxes associated with each device handler. */
-int device_mbox_ID[MAX_UNITS * 4];
+int device_mbox_ID[DEVICE_INDEX(SYS_INT + 1, 0)];
 
 sys_vec_func_t sys_vec[MAXSYSCALLS];
 
@@ -99,37 +110,36 @@ start1(char *arg)
 int
 MboxCreate(int num_slots, int slot_size)
 {
-    int table_position;
+    int table_position, box_ID;
     mailbox *box;
 
     KERNEL_MODE_CHECK;
     disableInterrupts();
 
-    next_box_ID = get_next_ID();
-    if (next_box_ID == -ENOIDS)
-        KERNEL_ERROR("All out of mailbox IDs.  Bummer.");
-
     if (boxes_in_use == MAXMBOX)
     {
         DP2(DEBUG2, "All mailboxes full: %d\n", boxes_in_use);
+        enableInterrupts();
         return -ENOBOX;
     }
 
     if ((slot_size < 0) || (slot_size > MAX_MESSAGE))
     {
         DP2(DEBUG, "Invalid slot_size %d\n", slot_size);
+        enableInterrupts();
         return -ESLOTSIZE;
     }
     
-    /* Find empty slot for this mailbox */
+    /* Find empty slot for this mailbox: its ID goes with the position */
     table_position = find_empty_mailbox();
     box = MailBoxTable + table_position;
+    box_ID = get_next_ID(table_position);
     
     /* Fill in mail box info*/
-    use_mailbox(box, next_box_ID, num_slots, slot_size);
+    use_mailbox(box, box_ID, num_slots, slot_size);
     enableInterrupts();
 
-    return next_box_ID;
+    return box_ID;
 }
 
 
@@ -146,7 +156,6 @@ MboxSend(int mbox_id, void *msg_ptr, int msg_size)
 {
     int invalid_ID, position, status = 0;
     mailbox *box;
-    mail_slot *slot;
 
     KERNEL_MODE_CHECK;
     disableInterrupts();
@@ -161,34 +170,7 @@ MboxSend(int mbox_id, void *msg_ptr, int msg_size)
     }
 
     box = MailBoxTable + position;
-
-    /* Okay, I think I finally got this.  NULL pointers are okay as
-       long as the message size is 0*/
-    if (!msg_ptr && (msg_size != 0))
-    {
-        DP2(DEBUG, "Null message pointer to mailbox %d\n", mbox_id);
-        status = -ENULLMSG;
-        goto out;
-    }
-
-    if ((msg_size > box->max_message_size) || (msg_size < 0))
-    {
-        DP2(DEBUG, "Invalid message size of %d to box %d\n", msg_size, mbox_id);
-        status = -EMSGSIZE;
-        goto out;
-    }
-
-    slot = get_free_slot(box); 
-    DP2(DEBUG3, "Free slot is %08x\n", slot);
-
-    if (slot && box->max_slots_count == 0)
-        KERNEL_ERROR("Had a slot for a 0 slot mailbox");
-
-    if (box->max_slots_count == 0)
-        /* 0 slot mailbox special case */
-        status = slotless_sender(box, msg_ptr, msg_size);
-    else 
-        status = slotful_sender(box, slot, msg_ptr, msg_size);
+    status = send_message(box, msg_ptr, msg_size);
 
 out:
     enableInterrupts();
@@ -216,10 +198,6 @@ MboxReceive(int mbox_id, void *msg_ptr, int msg_size)
 {
     int invalid_ID, position, status = 0;
     mailbox *box;
-    mail_slot *slot;
-
-    DP2(DEBUG3, "Receiving from mailbox %d into %08x with max of %d\n",
-        mbox_id, msg_ptr, msg_size);
 
     KERNEL_MODE_CHECK;
     disableInterrupts();
@@ -234,47 +212,124 @@ MboxReceive(int mbox_id, void *msg_ptr, int msg_size)
     }
 
     box = MailBoxTable + position;
+    status = receive_message(box, msg_ptr, msg_size);
+
+out:
+    enableInterrupts();
+    return status;
+}
+
+/*!
+    MboxSend(), but if the sender has to block for longer than
+    'timeout' usecs it gives up and returns -ETIMEDOUT.  Timeouts are
+    checked each clock interrupt, so they can run over by up to one,
+    and ones over about 17 minutes are cut to that: see timer.c.
+*/
 
-    // 0 slot mailboxes can have null message pointers.  Who knew?
-    if ((box->max_slots_count != 0) && !msg_ptr)
+int
+MboxSendTimed(int mbox_id, void *msg_ptr, int msg_size, int timeout)
+{
+    int invalid_ID, position, status = 0;
+
+    KERNEL_MODE_CHECK;
+    disableInterrupts();
+
+    invalid_ID = is_valid_mailbox(mbox_id, &position);
+    if (invalid_ID)
     {
-        DP2(DEBUG, "Null message pointer getting from mailbox %d\n", mbox_id);
-        status = -ENULLMSG;
+        DP2(DEBUG, "Invalid mbox_ID %d\n", mbox_id);
+        status = invalid_ID;
         goto out;
     }
 
-    // Sun Feb 20 14:35:47 MST 2005
-    //
-    // test case 03 makes it appear that sending in msg_size >
-    //max_message_size supported by the box is okay
-
-    //if ((msg_size > box->max_message_size) || (msg_size < 0))
-    if ((msg_size > MAX_MESSAGE) || (msg_size < 0))
+    if (timeout < 0)
     {
-        DP2(DEBUG, "Invalid max message size of %d getting from box %d\n",
-            msg_size, mbox_id);
+        DP2(DEBUG, "Negative timeout %d sending to box %d\n", timeout, mbox_id);
         status = -EMSGSIZE;
         goto out;
     }
 
-    /* Get message on front of queue for this mailbox: block if Null */
-    slot = get_next_slot(box);
+    timer_arm(timeout);
+    status = send_message(MailBoxTable + position, msg_ptr, msg_size);
+    timer_disarm();
+
+out:
+    enableInterrupts();
+    return status;
+}
 
-    DP2(DEBUG3, "Message slot is %08x\n", slot);
+/*!
+    MboxReceive(), but if the receiver has to block for longer than
+    'timeout' usecs it gives up and returns -ETIMEDOUT.  Timeouts are
+    checked each clock interrupt, so they can run over by up to one,
+    and ones over about 17 minutes are cut to that: see timer.c.
+*/
 
-    if (slot && box->max_slots_count == 0)
-        KERNEL_ERROR("Had a slot for a 0 slot mailbox");
+int
+MboxReceiveTimed(int mbox_id, void *msg_ptr, int msg_size, int timeout)
+{
+    int invalid_ID, position, status = 0;
 
-    if (box->max_slots_count == 0)
-        status = slotless_receive(box, msg_ptr, msg_size);
-    else 
-        status = slotful_receive(box, slot, msg_ptr, msg_size);
+    KERNEL_MODE_CHECK;
+    disableInterrupts();
+
+    invalid_ID = is_valid_mailbox(mbox_id, &position);
+    if (invalid_ID)
+    {
+        DP2(DEBUG, "Invalid mbox_ID %d\n", mbox_id);
+        status = invalid_ID;
+        goto out;
+    }
+
+    if (timeout < 0)
+    {
+        DP2(DEBUG, "Negative timeout %d getting from box %d\n",
+            timeout, mbox_id);
+        status = -EMSGSIZE;
+        goto out;
+    }
+
+    timer_arm(timeout);
+    status = receive_message(MailBoxTable + position, msg_ptr, msg_size);
+    timer_disarm();
 
 out:
     enableInterrupts();
     return status;
 }
 
+/*!
+    Turns on priority inheritance for mailbox 'box_ID': a sender that
+    blocks because the box is full lends its priority (see phase 1's
+    lend_priority()) to the sender of the oldest message in it, until
+    it gets unblocked.  Meant for mailboxes used as mutexes or
+    semaphores, where sending acquires and receiving releases, so the
+    oldest message's sender is the holder.
+
+    Returns 0, or -EBADBOX if 'box_ID' isn't a mailbox.
+*/
+
+int
+MboxInherit(int box_ID)
+{
+    int position, invalid;
+
+    KERNEL_MODE_CHECK;
+    disableInterrupts();
+
+    invalid = is_valid_mailbox(box_ID, &position);
+    if (invalid)
+    {
+        enableInterrupts();
+        return invalid;
+    }
+
+    MailBoxTable[position].inherit = 1;
+
+    enableInterrupts();
+    return 0;
+}
+
 /*!
     Releases a previously created mailbox.  All processes waiting on
     the mailbox return a status of -3 (i.e., notice that their mailbox
@@ -286,7 +341,7 @@ MboxRelease(int box_ID)
 {
     proc_entry *queued, *previous;
     mailbox *box;
-    int position, invalid, ret;
+    int position, invalid, ret, pid;
 
     KERNEL_MODE_CHECK;
     disableInterrupts();
@@ -307,17 +362,24 @@ MboxRelease(int box_ID)
     {
         DP2(DEBUG5, "Front is %08x\n", queued);
 
-        /* enables interrupts */
-        ret = unblock_proc(queued->pid);
-        if (ret != 0)
-            KERNEL_ERROR("Unable to unblock process %d", queued->pid);
-
-        DP2(DEBUG3,"Unblocked process %d\n", queued->pid);
-        
-        disableInterrupts();
+        /* Done with the entry before its process can run and use it
+           again: an MboxSelect()er's other entries come off their
+           queues too. */
         previous = queued;
         queued = queued->next;
+        pid = previous->pid;
+        if (previous->select)
+            select_cancel(previous);
         initialize_proc_entry(previous);
+
+        /* enables interrupts, and wakes 'pid' even if we're zapped */
+        ret = unblock_proc(pid);
+        if ((ret != 0) && !is_zapped())
+            KERNEL_ERROR("Unable to unblock process %d", pid);
+
+        DP2(DEBUG3,"Unblocked process %d\n", pid);
+        
+        disableInterrupts();
     }
 
 
@@ -364,11 +426,14 @@ MboxCondSend(int box_ID, void *msg_ptr, int msg_size)
             status = MboxSend(box_ID, msg_ptr, msg_size);
     } else
     {
+        /* a waiting receiver takes the message directly: no slot needed */
+        if (box->front && box->front->type == PROCESS_RECEIVER)
+            status = MboxSend(box_ID, msg_ptr, msg_size);
         /* slotful mailbox maxed out slots */
-        if (box->slots_count == box->max_slots_count)
+        else if (box->slots_count == box->max_slots_count)
             status = -EWOULDBLOCK;
         /* slotful mailbox no slots left in world */ 
-        else if (slots_in_use == MAXSLOTS)
+        else if (!slot_available(msg_size))
             status = -ENOSLOTS;
         else
             status = MboxSend(box_ID, msg_ptr, msg_size);
@@ -437,6 +502,229 @@ MboxCondReceive(int box_ID, void *msg_ptr, int msg_max_size)
     return status;
 }
 
+/*!
+    Sends 'count' messages to 'box_ID' in one call, as that many
+    MboxSend()s in a row would, blocking whenever the box is full.
+    Message i is sizes[i] bytes starting at msgs + i * stride, and
+    'stride' has to be positive: -EMSGSIZE if it isn't.
+
+    Returns the number of messages sent.  If the first couldn't be sent,
+    returns what MboxSend() would have instead.  A later message that
+    fails (bad size, or the box was released or the sender zapped while
+    blocked) stops the batch there.
+*/
+
+int
+MboxSendMany(int box_ID, void *msgs, int stride, int sizes[], int count)
+{
+    int invalid, position, sent = 0, status = 0;
+    mailbox *box;
+    char *msg_ptr = msgs;
+
+    KERNEL_MODE_CHECK;
+    disableInterrupts();
+
+    invalid = is_valid_mailbox(box_ID, &position);
+    if (invalid)
+    {
+        DP2(DEBUG, "Invalid mbox_ID %d\n", box_ID);
+        status = invalid;
+        goto out;
+    }
+
+    if (!sizes || (count < 1) || (stride < 1))
+    {
+        DP2(DEBUG, "Bad batch of %d to box %d: stride %d sizes %08x\n",
+            count, box_ID, stride, sizes);
+        status = -EMSGSIZE;
+        goto out;
+    }
+
+    box = MailBoxTable + position;
+
+    for ( ; sent < count; ++sent)
+    {
+        status = send_message(box, msg_ptr, sizes[sent]);
+        if (status)
+            break;
+        if (msg_ptr)
+            msg_ptr += stride;
+
+        /* Blocking may have turned them back on */
+        disableInterrupts();
+    }
+
+out:
+    enableInterrupts();
+    return sent ? sent : status;
+}
+
+/*!
+    Receives up to 'count' messages from 'box_ID' in one call.  Blocks,
+    as MboxReceive() does, until there's a first message, then takes
+    whatever else is waiting without blocking again.  Message i goes to
+    msgs + i * stride, which is also the most it can hold, and its size
+    to sizes[i].
+
+    Returns the number of messages received, or what MboxReceive() would
+    have if there wasn't one (and -EMSGSIZE for a 'stride' that isn't
+    positive).  A message bigger than 'stride' stops the batch, and is
+    left in the box.
+*/
+
+int
+MboxReceiveMany(int box_ID, void *msgs, int stride, int sizes[], int count)
+{
+    int invalid, position, received = 0, status = 0;
+    mailbox *box;
+    char *msg_ptr = msgs;
+
+    KERNEL_MODE_CHECK;
+    disableInterrupts();
+
+    invalid = is_valid_mailbox(box_ID, &position);
+    if (invalid)
+    {
+        DP2(DEBUG, "Invalid mbox_ID %d\n", box_ID);
+        status = invalid;
+        goto out;
+    }
+
+    if (!sizes || (count < 1) || (stride < 1))
+    {
+        DP2(DEBUG, "Bad batch of %d from box %d: stride %d sizes %08x\n",
+            count, box_ID, stride, sizes);
+        status = -EMSGSIZE;
+        goto out;
+    }
+
+    box = MailBoxTable + position;
+
+    /* Only the first receive may block */
+    status = receive_message(box, msg_ptr, stride);
+    disableInterrupts();
+
+    for ( ; status >= 0; status = receive_message(box, msg_ptr, stride))
+    {
+        sizes[received] = status;
+        if (msg_ptr)
+            msg_ptr += stride;
+
+        if ((++received == count) || !message_waiting(box))
+            break;
+    }
+
+out:
+    enableInterrupts();
+    return received ? received : status;
+}
+
+/*!
+    Receives a message from whichever of the 'count' mailboxes in
+    'box_IDs' has one first, so that one process can wait on several
+    queues.  If some already have messages, the first of those in
+    'box_IDs' gives one up; otherwise the process blocks, queued as a
+    receiver on all of them, until a message arrives at any.  The
+    message goes to 'msg_ptr', which holds up to 'msg_max_size' bytes,
+    and its size to 'msg_size'.
+
+    Returns the index in 'box_IDs' of the mailbox the message came
+    from, or
+
+        -EBADBOX if any ID isn't a mailbox (or turns up twice)
+        -EMSGSIZE for a bad 'count', 'msg_max_size' or 'msg_size'
+        -ENULLMSG for a NULL 'msg_ptr' with any slotful mailbox
+        -ESLOTSIZE if the waiting message is bigger than 'msg_max_size'
+        -EZAPPED if zapped while blocked
+        -EBOXRELEASED if the mailbox was released while blocked
+*/
+
+int
+MboxSelect(int box_IDs[], int count, void *msg_ptr, int msg_max_size,
+           int *msg_size)
+{
+    int i, j, status = 0;
+    mailbox *box;
+
+    KERNEL_MODE_CHECK;
+    disableInterrupts();
+
+    if (!box_IDs || !msg_size || (count < 1) || (count > MAX_SELECT)
+        || (msg_max_size < 0) || (msg_max_size > MAX_MESSAGE))
+    {
+        DP2(DEBUG, "Bad select of %d boxes for %d bytes\n",
+            count, msg_max_size);
+        status = -EMSGSIZE;
+        goto out;
+    }
+
+    for (i = 0; i < count; ++i)
+    {
+        status = is_valid_mailbox(box_IDs[i], NULL);
+        for (j = 0; !status && (j < i); ++j)
+            if (box_IDs[j] == box_IDs[i])
+                status = -EBADBOX;
+        if (status)
+        {
+            DP2(DEBUG, "Can't select on box %d\n", box_IDs[i]);
+            goto out;
+        }
+
+        // 0 slot mailboxes can have null message pointers
+        if (!msg_ptr
+            && MailBoxTable[ID_TO_POSITION(box_IDs[i])].max_slots_count)
+        {
+            status = -ENULLMSG;
+            goto out;
+        }
+    }
+
+    /* Something waiting already?  Then no need to block */
+    for (i = 0; i < count; ++i)
+    {
+        box = MailBoxTable + ID_TO_POSITION(box_IDs[i]);
+        if (!message_waiting(box))
+            continue;
+
+        status = receive_message(box, msg_ptr, msg_max_size);
+        if (status >= 0)
+        {
+            *msg_size = status;
+            status = i;
+        }
+        goto out;
+    }
+
+    status = handle_select_and_blocking(box_IDs, count, msg_ptr,
+                                        msg_max_size);
+    if (status >= 0)
+    {
+        *msg_size = select_table[CURRENT].entries[status].msg_size;
+        TRACE_EVENT(TRACE_RECEIVE, box_IDs[status], *msg_size);
+    }
+
+out:
+    enableInterrupts();
+    return status;
+}
+
+/*!
+    The ID of the mailbox waitdevice('type', 'unit') waits on, for
+    MboxSelect(): a message on it is the device's status (nothing, for
+    the clock).
+*/
+
+int
+devicebox(int type, int unit)
+{
+    KERNEL_MODE_CHECK;
+
+    if ((type < CLOCK_DEV) || (type > SYSCALL))
+        KERNEL_ERROR("Invalid device type %d", type);
+
+    return device_mbox_ID[DEVICE_INDEX(type, unit)];
+}
+
 /*!
         
 */
@@ -454,7 +742,7 @@ waitdevice(int type, int unit, int *device_status)
 
     DP2(DEBUG, "type == %d unit == %d\n", type, unit);
 
-    box_ID = device_mbox_ID[type + unit]; 
+    box_ID = device_mbox_ID[DEVICE_INDEX(type, unit)];
     DP2(DEBUG, "type %d has mailbox %d\n", type, box_ID);
     status = MboxReceive(box_ID, device_status, sizeof(*device_status));
 
@@ -0,0 +1,25 @@
+/* start2 runs alone: with nothing else ready but the sentinel, the
+ * clock handler should skip its ticks.  dump_processes() gives the count,
+ * which should be non-zero. */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+
+
+int start2(char *arg)
+{
+   int start;
+
+   printf("start2(): started, spinning alone for 500 ms\n");
+
+   start = sys_clock();
+   while (sys_clock() - start < 500000)
+      ;
+
+   dump_processes();
+   printf("start2(): done\n");
+   quit(0);
+   return 0;
+}
@@ -0,0 +1,57 @@
+/* MboxReceiveTimed(): an empty mailbox times out after about 100 ms
+ * with -4 (ETIMEDOUT), and a timeout too long to add to sys_clock()
+ * without overflowing still waits for, and gets, XXp1's message. */
+
+#include <stdio.h>
+#include <limits.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+
+int XXp1(char *);
+int mbox_id;
+
+
+int start2(char *arg)
+{
+   int kid_status, kidpid, result, start, elapsed;
+   char buffer[20];
+
+   mbox_id = MboxCreate(1, sizeof(buffer));
+   printf("start2(): MboxCreate returned id = %d\n", mbox_id);
+
+   start = sys_clock();
+   result = MboxReceiveTimed(mbox_id, buffer, sizeof(buffer), 100000);
+   elapsed = (sys_clock() - start) / 1000;
+   printf("start2(): empty mailbox, result = %d\n", result);
+   printf("start2(): waited at least 100 ms: %s\n",
+          elapsed >= 100 ? "yes" : "no");
+
+   kidpid = fork1("XXp1", XXp1, NULL, 2 * USLOSS_MIN_STACK, 3);
+
+   result = MboxReceiveTimed(mbox_id, buffer, sizeof(buffer), INT_MAX);
+   printf("start2(): INT_MAX timeout, result = %d, message = `%s'\n",
+          result, buffer);
+
+   kidpid = join(&kid_status);
+   printf("start2(): joined with kid %d, status = %d\n",
+          kidpid, kid_status);
+
+   quit(0);
+   return 0;
+}
+
+int XXp1(char *arg)
+{
+   int start = sys_clock();
+
+   /* Let a few clock interrupts check start2's deadline first */
+   while (sys_clock() - start < 100000)
+      ;
+
+   printf("XXp1(): sending message to mailbox %d\n", mbox_id);
+   MboxSend(mbox_id, "hello there", 12);
+
+   quit(-3);
+   return 0;
+}
@@ -0,0 +1,85 @@
+/* MboxSendTimed(): a sender blocked on a full mailbox times out after
+ * about 100 ms with -4 (ETIMEDOUT), even though the clock interrupt
+ * that notices is running on behalf of XXp2, which XXp3 has zapped. */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+
+int XXp1(char *);
+int XXp2(char *);
+int XXp3(char *);
+int mbox_id;
+int spinner_pid;
+int spinner_done;
+
+
+int start2(char *arg)
+{
+   int kid_status, kidpid, i, result;
+
+   mbox_id = MboxCreate(1, 20);
+   printf("start2(): MboxCreate returned id = %d\n", mbox_id);
+   result = MboxSend(mbox_id, "fill", 5);
+   printf("start2(): filled the only slot, result = %d\n", result);
+
+   fork1("XXp1", XXp1, NULL, 2 * USLOSS_MIN_STACK, 2);
+   spinner_pid = fork1("XXp2", XXp2, NULL, 2 * USLOSS_MIN_STACK, 5);
+   fork1("XXp3", XXp3, NULL, 2 * USLOSS_MIN_STACK, 3);
+
+   for (i = 0; i < 3; i++)
+   {
+      kidpid = join(&kid_status);
+      printf("start2(): joined with kid %d, status = %d\n",
+             kidpid, kid_status);
+   }
+
+   quit(0);
+   return 0;
+}
+
+int XXp1(char *arg)
+{
+   int result, start, elapsed;
+
+   printf("XXp1(): sending to full mailbox %d for up to 100 ms\n", mbox_id);
+   start = sys_clock();
+   result = MboxSendTimed(mbox_id, "late", 5, 100000);
+   elapsed = (sys_clock() - start) / 1000;
+   printf("XXp1(): result = %d\n", result);
+   printf("XXp1(): waited at least 100 ms: %s\n",
+          elapsed >= 100 ? "yes" : "no");
+   printf("XXp1(): XXp2 done spinning: %s\n", spinner_done ? "yes" : "no");
+
+   quit(-3);
+   return 0;
+}
+
+int XXp2(char *arg)
+{
+   int start = sys_clock();
+
+   /* Zapped before it gets here, and still spinning when XXp1's
+      deadline goes by */
+   printf("XXp2(): spinning, zapped = %d\n", is_zapped());
+   while (sys_clock() - start < 300000)
+      ;
+   spinner_done = 1;
+   printf("XXp2(): done spinning\n");
+
+   quit(-4);
+   return 0;
+}
+
+int XXp3(char *arg)
+{
+   int result;
+
+   printf("XXp3(): zapping XXp2\n");
+   result = zap(spinner_pid);
+   printf("XXp3(): zap returned %d\n", result);
+
+   quit(-5);
+   return 0;
+}
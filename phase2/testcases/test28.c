@@ -0,0 +1,125 @@
+/* MboxSelect(): start2 gets a message that's already waiting without
+ * blocking.  XXp1 blocks on both mailboxes and is woken by XXp2's send
+ * to the second; its entry on the first is gone, so XXp2's later send
+ * there stays for MboxCondReceive().  XXp3 blocks on both again, and
+ * XXp4 releases the first out from under it: -3, and the second
+ * mailbox is left alone. */
+
+#include <stdio.h>
+#include <string.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+
+int XXp1(char *);
+int XXp2(char *);
+int XXp3(char *);
+int XXp4(char *);
+int boxes[2];
+
+
+int start2(char *arg)
+{
+   int kid_status, kidpid, i, result, size;
+   char buffer[50];
+
+   boxes[0] = MboxCreate(5, 50);
+   boxes[1] = MboxCreate(5, 50);
+   printf("start2(): MboxCreate returned ids %d and %d\n",
+          boxes[0], boxes[1]);
+
+   MboxSend(boxes[1], "waiting", 8);
+   result = MboxSelect(boxes, 2, buffer, 50, &size);
+   printf("start2(): MboxSelect returned %d, size %d, message '%s'\n",
+          result, size, buffer);
+
+   fork1("XXp1", XXp1, NULL, 2 * USLOSS_MIN_STACK, 3);
+   fork1("XXp2", XXp2, NULL, 2 * USLOSS_MIN_STACK, 4);
+   for (i = 0; i < 2; i++)
+   {
+      kidpid = join(&kid_status);
+      printf("start2(): joined with kid %d, status = %d\n",
+             kidpid, kid_status);
+   }
+
+   fork1("XXp3", XXp3, NULL, 2 * USLOSS_MIN_STACK, 3);
+   fork1("XXp4", XXp4, NULL, 2 * USLOSS_MIN_STACK, 4);
+   for (i = 0; i < 2; i++)
+   {
+      kidpid = join(&kid_status);
+      printf("start2(): joined with kid %d, status = %d\n",
+             kidpid, kid_status);
+   }
+
+   quit(0);
+   return 0;
+}
+
+int XXp1(char *arg)
+{
+   int result, size;
+   char buffer[50];
+
+   printf("XXp1(): selecting on mailboxes %d and %d\n", boxes[0], boxes[1]);
+   result = MboxSelect(boxes, 2, buffer, 50, &size);
+   printf("XXp1(): MboxSelect returned %d, size %d, message '%s'\n",
+          result, size, buffer);
+
+   quit(-3);
+   return 0;
+}
+
+int XXp2(char *arg)
+{
+   int result;
+   char buffer[50];
+
+   printf("XXp2(): sending to mailbox %d\n", boxes[1]);
+   result = MboxSend(boxes[1], "second", 7);
+   printf("XXp2(): after send, result = %d\n", result);
+
+   result = MboxCondSend(boxes[0], "first", 6);
+   printf("XXp2(): MboxCondSend to mailbox %d returned %d\n",
+          boxes[0], result);
+   strcpy(buffer, "");
+   result = MboxCondReceive(boxes[0], buffer, 50);
+   printf("XXp2(): MboxCondReceive returned %d, message '%s'\n",
+          result, buffer);
+
+   quit(-4);
+   return 0;
+}
+
+int XXp3(char *arg)
+{
+   int result, size;
+   char buffer[50];
+
+   printf("XXp3(): selecting on mailboxes %d and %d\n", boxes[0], boxes[1]);
+   result = MboxSelect(boxes, 2, buffer, 50, &size);
+   printf("XXp3(): MboxSelect returned %d\n", result);
+
+   quit(-5);
+   return 0;
+}
+
+int XXp4(char *arg)
+{
+   int result;
+   char buffer[50];
+
+   printf("XXp4(): releasing mailbox %d\n", boxes[0]);
+   result = MboxRelease(boxes[0]);
+   printf("XXp4(): after release, result = %d\n", result);
+
+   result = MboxCondSend(boxes[1], "after", 6);
+   printf("XXp4(): MboxCondSend to mailbox %d returned %d\n",
+          boxes[1], result);
+   strcpy(buffer, "");
+   result = MboxCondReceive(boxes[1], buffer, 50);
+   printf("XXp4(): MboxCondReceive returned %d, message '%s'\n",
+          result, buffer);
+
+   quit(-6);
+   return 0;
+}
@@ -0,0 +1,122 @@
+/* Priority inheritance through an MboxInherit() mutex.  Low (priority 5)
+ * holds it; High (priority 2) blocks trying to take it, lending Low its
+ * priority, so Medium (priority 3) has to wait until Low lets go.
+ * Receiving the message pays the loan back, and High and then Medium
+ * run before Low gets any further.
+ *
+ * Then Low2 holds it and High2 gives up after 50 ms (MboxSendTimed()).
+ * The timeout pays the loan back too: Medium2 runs while Low2 is still
+ * spinning. */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+
+int Low(char *);
+int High(char *);
+int Medium(char *);
+int Low2(char *);
+int High2(char *);
+int mutex;
+char buffer[1];
+
+
+int start2(char *arg)
+{
+   int kid_status, kidpid, result;
+
+   mutex = MboxCreate(1, 0);
+   result = MboxInherit(mutex);
+   printf("start2(): mutex is mailbox %d, MboxInherit returned %d\n",
+          mutex, result);
+
+   fork1("Low", Low, NULL, 2 * USLOSS_MIN_STACK, 5);
+   kidpid = join(&kid_status);
+   printf("start2(): joined with kid %d, status = %d\n", kidpid, kid_status);
+
+   fork1("Low2", Low2, NULL, 2 * USLOSS_MIN_STACK, 5);
+   kidpid = join(&kid_status);
+   printf("start2(): joined with kid %d, status = %d\n", kidpid, kid_status);
+
+   quit(0);
+   return 0;
+}
+
+int Low(char *arg)
+{
+   int kid_status, i;
+
+   MboxSend(mutex, NULL, 0);
+   printf("Low(): took the mutex\n");
+
+   /* High blocks on the mutex right away; Medium can't get in while
+      High's priority is on loan to us */
+   fork1("High", High, NULL, 2 * USLOSS_MIN_STACK, 2);
+   fork1("Medium", Medium, "Medium", 2 * USLOSS_MIN_STACK, 3);
+   printf("Low(): releasing the mutex\n");
+   MboxReceive(mutex, buffer, 0);
+   printf("Low(): released the mutex\n");
+
+   for (i = 0; i < 2; i++)
+      join(&kid_status);
+
+   quit(-3);
+   return 0;
+}
+
+int High(char *arg)
+{
+   printf("High(): taking the mutex\n");
+   MboxSend(mutex, NULL, 0);
+   printf("High(): took the mutex\n");
+   MboxReceive(mutex, buffer, 0);
+
+   quit(-4);
+   return 0;
+}
+
+int Medium(char *arg)
+{
+   printf("%s(): running\n", arg);
+
+   quit(-5);
+   return 0;
+}
+
+int Low2(char *arg)
+{
+   int kid_status, i, start;
+
+   MboxSend(mutex, NULL, 0);
+   printf("Low2(): took the mutex\n");
+
+   fork1("High2", High2, NULL, 2 * USLOSS_MIN_STACK, 2);
+   fork1("Medium2", Medium, "Medium2", 2 * USLOSS_MIN_STACK, 3);
+
+   /* Long past High2's timeout */
+   printf("Low2(): spinning for 300 ms\n");
+   start = sys_clock();
+   while (sys_clock() - start < 300000)
+      ;
+   printf("Low2(): done spinning\n");
+   MboxReceive(mutex, buffer, 0);
+
+   for (i = 0; i < 2; i++)
+      join(&kid_status);
+
+   quit(-6);
+   return 0;
+}
+
+int High2(char *arg)
+{
+   int result;
+
+   printf("High2(): taking the mutex for up to 50 ms\n");
+   result = MboxSendTimed(mutex, NULL, 0, 50000);
+   printf("High2(): MboxSendTimed returned %d\n", result);
+
+   quit(-7);
+   return 0;
+}
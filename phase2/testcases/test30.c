@@ -0,0 +1,79 @@
+/* A deadlock through all three kinds of wait phase 1 keeps track of:
+ * start2 holds an MboxInherit() mutex and zaps XXp1; XXp1 joins its
+ * only child XXp2; XXp2 blocks on the mutex.  Closing the loop should
+ * get it reported, as 3 processes, each with whom it's waiting for and
+ * why.  Breaker then releases the mutex, which lets everybody go. */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+
+int XXp1(char *);
+int XXp2(char *);
+int Breaker(char *);
+int mutex;
+
+
+int start2(char *arg)
+{
+   int kid_status, kidpid, pid, result, i;
+
+   mutex = MboxCreate(1, 0);
+   MboxInherit(mutex);
+   MboxSend(mutex, NULL, 0);
+   printf("start2(): holding mutex %d\n", mutex);
+
+   fork1("Breaker", Breaker, NULL, 2 * USLOSS_MIN_STACK, 5);
+   pid = fork1("XXp1", XXp1, NULL, 2 * USLOSS_MIN_STACK, 2);
+   printf("start2(): zapping XXp1\n");
+   result = zap(pid);
+   printf("start2(): zap returned %d\n", result);
+
+   for (i = 0; i < 2; i++)
+   {
+      kidpid = join(&kid_status);
+      printf("start2(): joined with kid %d, status = %d\n",
+             kidpid, kid_status);
+   }
+
+   quit(0);
+   return 0;
+}
+
+int XXp1(char *arg)
+{
+   int kid_status, kidpid;
+
+   fork1("XXp2", XXp2, NULL, 2 * USLOSS_MIN_STACK, 3);
+   printf("XXp1(): joining with XXp2\n");
+   kidpid = join(&kid_status);
+   printf("XXp1(): joined with kid %d, status = %d\n", kidpid, kid_status);
+
+   quit(-3);
+   return 0;
+}
+
+int XXp2(char *arg)
+{
+   int result;
+
+   printf("XXp2(): taking mutex %d\n", mutex);
+   result = MboxSend(mutex, NULL, 0);
+   printf("XXp2(): MboxSend returned %d\n", result);
+
+   quit(-4);
+   return 0;
+}
+
+int Breaker(char *arg)
+{
+   int result;
+
+   printf("Breaker(): releasing mutex %d\n", mutex);
+   result = MboxRelease(mutex);
+   printf("Breaker(): MboxRelease returned %d\n", result);
+
+   quit(-5);
+   return 0;
+}
@@ -0,0 +1,73 @@
+/* Running out of message slots.  start2 fills a mailbox with MAXSLOTS
+ * messages of MAX_MESSAGE bytes: more than the slab has slots that
+ * big, so the rest come from the heap, and then MboxCondSend() says -2.
+ * They all come back intact, and the heap slots are given back: the
+ * box fills up the same way again.  Then empty messages, spread over
+ * several mailboxes, get every slot there is. */
+
+#include <stdio.h>
+#include <string.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+
+#define BOXES 8
+
+int fill(int box, int size);
+
+
+int start2(char *arg)
+{
+   int big, spare, boxes[BOXES], i, j, count, result, intact = 1;
+   char buffer[MAX_MESSAGE];
+
+   big = MboxCreate(MAXSLOTS, MAX_MESSAGE);
+   spare = MboxCreate(1, MAX_MESSAGE);
+   for (j = 0; j < 2; j++)
+   {
+      count = fill(big, MAX_MESSAGE);
+      printf("start2(): %d messages of %d bytes fit\n", count, MAX_MESSAGE);
+      result = MboxCondSend(spare, buffer, MAX_MESSAGE);
+      printf("start2(): one more in another mailbox: %d\n", result);
+
+      for (i = 0; i < count; i++)
+      {
+         result = MboxCondReceive(big, buffer, MAX_MESSAGE);
+         if ((result != MAX_MESSAGE) || (buffer[0] != (char)i)
+             || (buffer[MAX_MESSAGE - 1] != (char)i))
+            intact = 0;
+      }
+      printf("start2(): all came back intact: %s\n", intact ? "yes" : "no");
+   }
+   MboxRelease(big);
+   MboxRelease(spare);
+
+   count = 0;
+   for (i = 0; i < BOXES; i++)
+   {
+      boxes[i] = MboxCreate(MAXSLOTS, 0);
+      count += fill(boxes[i], 0);
+   }
+   printf("start2(): %d empty messages fit\n", count);
+   for (i = 0; i < BOXES; i++)
+      MboxRelease(boxes[i]);
+
+   quit(0);
+   return 0;
+}
+
+/* Send 'size' byte messages to 'box' until there's no slot left for one */
+int fill(int box, int size)
+{
+   char buffer[MAX_MESSAGE];
+   int count = 0, result;
+
+   do {
+      memset(buffer, count, sizeof(buffer));
+      result = MboxCondSend(box, buffer, size);
+   } while ((result == 0) && (++count < MAXSLOTS));
+
+   if (result != 0)
+      printf("fill(): MboxCondSend returned %d\n", result);
+   return count;
+}
@@ -0,0 +1,178 @@
+/*!
+    Author: Robert Crocombe
+    Class: CS452 Operating Systems Spring 2005
+
+    Deadlines for MboxSendTimed() and MboxReceiveTimed().  The call
+    arms the current process's timer, then goes through the usual send
+    or receive: if that blocks, handle_enqueue_and_blocking() puts the
+    timer on the list, soonest deadline first, and takes it off again
+    when the process wakes up.  clock_handler() expires the timers that
+    are up each clock interrupt, so a timeout is good to within one.
+
+    An expired timer takes its process off the mailbox queue and
+    unblocks it, and handle_enqueue_and_blocking() returns -ETIMEDOUT.
+    If the process isn't on the queue any more, something else already
+    woke it, and it gets what that gave it.
+
+    sys_clock() wraps after about 35 minutes, so deadlines are unsigned
+    and compared by their difference, and timeouts are capped at
+    TIMEOUT_MAX so that difference always fits in an int.
+
+    Callers have interrupts disabled.
+*/
+
+#include "helper.h"
+#include "utility.h"
+#include "timer.h"
+
+#include <phase1.h>
+#include <limits.h>
+
+/* About 17 minutes */
+#define TIMEOUT_MAX (INT_MAX / 2)
+
+extern mail_box MailBoxTable[];
+
+typedef struct _mbox_timer mbox_timer;
+
+struct _mbox_timer
+{
+    int armed;          /* the process's next wait has a deadline */
+    unsigned int deadline;  /* sys_clock() time the wait is up */
+    int expired;        /* woken by the timer, not the mailbox */
+    int pid;
+    int box_ID;         /* the mailbox, and its queue entry */
+    proc_entry *entry;
+    mbox_timer *next;   /* on the list, while blocked */
+};
+
+static mbox_timer timer_table[MAXPROC];
+
+/* Timers of blocked processes, soonest deadline first */
+static mbox_timer *timers;
+
+/*!
+    Returns 1 if deadline 'a' is no later than 'b', across a wrap of
+    sys_clock() too.
+*/
+
+static int
+no_later(unsigned int a, unsigned int b)
+{
+    return (int)(a - b) <= 0;
+}
+
+/*!
+    The current process's next wait on a mailbox lasts at most
+    'timeout' usecs, or TIMEOUT_MAX if that's less.
+*/
+
+void
+timer_arm(int timeout)
+{
+    mbox_timer *t = timer_table + CURRENT;
+
+    if (timeout > TIMEOUT_MAX)
+        timeout = TIMEOUT_MAX;
+
+    t->armed = 1;
+    t->deadline = (unsigned int)sys_clock() + timeout;
+}
+
+void
+timer_disarm(void)
+{
+    timer_table[CURRENT].armed = 0;
+}
+
+/*!
+    The current process is about to block with entry 'p' on mailbox
+    'box': if its timer is armed, put it on the list.
+*/
+
+void
+timer_start(mailbox *box, proc_entry *p)
+{
+    mbox_timer *t = timer_table + CURRENT;
+    mbox_timer **link = &timers;
+
+    if (!t->armed)
+        return;
+
+    t->expired = 0;
+    t->pid = getpid();
+    t->box_ID = box->mbox_ID;
+    t->entry = p;
+
+    while (*link && no_later((*link)->deadline, t->deadline))
+        link = &(*link)->next;
+    t->next = *link;
+    *link = t;
+}
+
+/*!
+    The current process is awake again: take its timer off the list if
+    it's still there.  Returns 1 if the timer is what woke it.
+*/
+
+int
+timer_stop(void)
+{
+    mbox_timer *t = timer_table + CURRENT;
+    mbox_timer **link = &timers;
+
+    if (!t->armed)
+        return 0;
+
+    for ( ; *link; link = &(*link)->next)
+        if (*link == t)
+        {
+            *link = t->next;
+            break;
+        }
+    t->next = NULL;
+
+    return t->expired;
+}
+
+/*!
+    From clock_handler(): wake everyone whose deadline has passed.
+*/
+
+void
+timers_expire(void)
+{
+    const unsigned int now = sys_clock();
+    mbox_timer *t;
+    mailbox *box;
+
+    while (timers && no_later(timers->deadline, now))
+    {
+        t = timers;
+        timers = t->next;
+        t->next = NULL;
+
+        box = MailBoxTable + ID_TO_POSITION(t->box_ID);
+        if ((box->mbox_ID != t->box_ID) || !remove_from_queue(box, t->entry))
+            continue;
+
+        DP2(DEBUG2, "Process %d timed out on box %d\n", t->pid, t->box_ID);
+
+        /* unblock_proc() pays back a sender's priority loan, if any.
+           It only complains about a zapped Current after waking t->pid. */
+        t->expired = 1;
+        if (unblock_proc(t->pid) && !is_zapped())
+            KERNEL_ERROR("Failed to unblock timed out process %d", t->pid);
+        disableInterrupts();
+    }
+}
+
+/*!
+    Returns 1 if anyone is blocked with a deadline, else 0.
+*/
+
+int
+timers_pending(void)
+{
+    return timers != NULL;
+}
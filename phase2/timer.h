@@ -0,0 +1,13 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "message.h"
+
+void timer_arm(int timeout);
+void timer_disarm(void);
+void timer_start(mailbox *box, proc_entry *p);
+int timer_stop(void);
+void timers_expire(void);
+int timers_pending(void);
+
+#endif  /* TIMER_H */
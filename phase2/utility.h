@@ -12,6 +12,7 @@
 
 #include <stdio.h>  /* macros may be used in files without stdio.h */
 #include "usloss.h" /* console() */
+#include <trace.h>  /* TRACE_EVENT */
 #include "message.h"
 
 /******************************************************************************/
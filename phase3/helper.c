@@ -22,6 +22,10 @@ extern semaphore_t semaphore_table[];
 extern proc_struct_t process_table[];
 extern void (*sys_vec[])(sysargs *args);
 
+/* start3() is in the testcases, or in phase 4, which also has start4() */
+extern int start3(char *arg);
+extern int start4(char *arg) __attribute__((weak));
+
 /******************************************************************************/
 /* Macros and Constants                                                       */
 /******************************************************************************/
@@ -80,7 +84,7 @@ extern void (*sys_vec[])(sysargs *args);
     Anyway, given a pointer 'a' and an integer 'b', assigns the
     literal value of 'b' into 'a' by treating it as a pointer to void.
 */
-#define INT_TO_POINTER(a,b) a = (void *)b
+#define INT_TO_POINTER(a,b) a = (void *)(b)
 #define ZERO_POINTER(a) a = NULL
 
 /* Mnemonics for IDs for empty mailboxes and process table entries */
@@ -96,6 +100,7 @@ extern void (*sys_vec[])(sysargs *args);
 #define ETERMINATE -1
 
 #define ENOKIDS -2
+#define ENOCPU -2
 
 /******************************************************************************/
 /* Prototypes for internal functions                                          */
@@ -112,6 +117,13 @@ static void sem_free(sysargs *args);
 static void get_time_of_day(sysargs *args);
 static void CPU_time(sysargs *args);
 static void get_pid(sysargs *args);
+static void set_ticket_count(sysargs *args);
+static void proc_stats_get(sysargs *args);
+static void rt_reservation(sysargs *args);
+static void mbox_create(sysargs *args);
+static void mbox_release(sysargs *args);
+static void mbox_send_many(sysargs *args);
+static void mbox_receive_many(sysargs *args);
 
 /* These do the real work of the above syscalls */
 static void terminate_real(int quit_code);
@@ -443,6 +455,144 @@ get_pid(sysargs *args)
     INT_TO_POINTER(args->arg1, pid);
 }
 
+/*!
+    Set the stride scheduling tickets for a process.  Phase 1 does all
+    the checking: -1 for a bad ticket count or pid.
+*/
+
+void
+set_ticket_count(sysargs *args)
+{
+    int ret;
+
+    STANDARD_CHECKS(SYS_SETTICKETS, set_ticket_count);
+
+    ret = set_tickets(INT_ME(args->arg1), INT_ME(args->arg2));
+    INT_TO_POINTER(args->arg4, (ret < 0) ? EBADARGS : 0);
+}
+
+/*!
+    Copy a process's scheduling statistics (see phase1.h) to the
+    caller's proc_stats: -1 for a bad pid or NULL pointer.
+*/
+
+void
+proc_stats_get(sysargs *args)
+{
+    int ret = EBADARGS;
+
+    STANDARD_CHECKS(SYS_PROCSTATS, proc_stats_get);
+
+    if (args->arg2)
+        ret = get_proc_stats(INT_ME(args->arg1), args->arg2);
+    INT_TO_POINTER(args->arg4, (ret < 0) ? EBADARGS : 0);
+}
+
+/*!
+    Take (or with a 0 period, give up) an EDF reservation for the
+    calling process: 'budget' us of CPU every 'period' us.  See
+    rt_reserve().  -1 for a bad period or budget, -2 if there isn't
+    that much CPU left to promise.
+*/
+
+void
+rt_reservation(sysargs *args)
+{
+    int ret;
+
+    STANDARD_CHECKS(SYS_RTRESERVE, rt_reservation);
+
+    ret = rt_reserve(INT_ME(args->arg1), INT_ME(args->arg2));
+    if (ret == -3)      /* no CPU left to promise */
+        INT_TO_POINTER(args->arg4, ENOCPU);
+    else
+        INT_TO_POINTER(args->arg4, (ret < 0) ? EBADARGS : 0);
+}
+
+/*!
+    Create a mailbox, so that user processes have somewhere to use the
+    batch calls below.
+
+    Sysargs upon entering:
+
+    arg1: number of slots
+    arg2: largest message size
+
+    arg1 on return: the mailbox ID
+    arg4 on return: 0, or -1 if MboxCreate() failed
+*/
+
+void
+mbox_create(sysargs *args)
+{
+    int ret;
+
+    STANDARD_CHECKS(SYS_MBOXCREATE, mbox_create);
+
+    ret = MboxCreate(INT_ME(args->arg1), INT_ME(args->arg2));
+    INT_TO_POINTER(args->arg1, ret);
+    INT_TO_POINTER(args->arg4, (ret < 0) ? EBADARGS : 0);
+}
+
+/*!
+    Release the mailbox whose ID is in arg1.  arg4 on return: 0, or -1
+    if MboxRelease() failed.
+*/
+
+void
+mbox_release(sysargs *args)
+{
+    int ret;
+
+    STANDARD_CHECKS(SYS_MBOXRELEASE, mbox_release);
+
+    ret = MboxRelease(INT_ME(args->arg1));
+    INT_TO_POINTER(args->arg4, (ret < 0) ? EBADARGS : 0);
+}
+
+/*!
+    Send a batch of messages to a mailbox: see MboxSendMany().
+
+    Sysargs upon entering:
+
+    arg1: mailbox ID
+    arg2: the messages, 'stride' bytes apart
+    arg3: stride
+    arg4: message sizes
+    arg5: count
+
+    arg4 on return: messages sent, or MboxSendMany()'s error code
+*/
+
+void
+mbox_send_many(sysargs *args)
+{
+    int ret;
+
+    STANDARD_CHECKS(SYS_MBOXSENDMANY, mbox_send_many);
+
+    ret = MboxSendMany(INT_ME(args->arg1), args->arg2, INT_ME(args->arg3),
+                       args->arg4, INT_ME(args->arg5));
+    INT_TO_POINTER(args->arg4, ret);
+}
+
+/*!
+    Receive a batch of messages from a mailbox: see MboxReceiveMany().
+    Sysargs as for mbox_send_many(), with the message sizes filled in.
+*/
+
+void
+mbox_receive_many(sysargs *args)
+{
+    int ret;
+
+    STANDARD_CHECKS(SYS_MBOXRECEIVEMANY, mbox_receive_many);
+
+    ret = MboxReceiveMany(INT_ME(args->arg1), args->arg2, INT_ME(args->arg3),
+                          args->arg4, INT_ME(args->arg5));
+    INT_TO_POINTER(args->arg4, ret);
+}
+
 /******************************************************************************/
 /* "Real" functions -- kernel mode functions that actually do work            */
 /******************************************************************************/
@@ -615,6 +765,9 @@ sem_create_real(int count)
 
     box_ID = MboxCreate(count, 0);
     semaphore_table[sem_ID].box_ID = box_ID;
+
+    /* P on a taken semaphore: lend priority to whoever took it */
+    (void)MboxInherit(box_ID);
     semaphore_table[sem_ID].count = count;
 
     DP(DEBUG3, "Process %d created a sem with count == '%d': "
@@ -819,6 +972,13 @@ initialize_sys_vec(void)
     sys_vec[SYS_GETTIMEOFDAY]   = get_time_of_day;
     sys_vec[SYS_CPUTIME]        = CPU_time;
     sys_vec[SYS_GETPID]         = get_pid;
+    sys_vec[SYS_SETTICKETS]     = set_ticket_count;
+    sys_vec[SYS_PROCSTATS]      = proc_stats_get;
+    sys_vec[SYS_RTRESERVE]      = rt_reservation;
+    sys_vec[SYS_MBOXCREATE]     = mbox_create;
+    sys_vec[SYS_MBOXRELEASE]    = mbox_release;
+    sys_vec[SYS_MBOXSENDMANY]   = mbox_send_many;
+    sys_vec[SYS_MBOXRECEIVEMANY] = mbox_receive_many;
 }
 
 /******************************************************************************/
@@ -827,7 +987,7 @@ initialize_sys_vec(void)
 
 /*!
     Wrapped around the user's function so that we can set the mode to
-    user-mode, and additionally to make sure that the task terminates
+    user-mode (except for phase 4's start3()), and additionally to make sure that the task terminates
     properly if it should return to this routine (returned from its
     function).
 
@@ -843,7 +1003,7 @@ initialize_sys_vec(void)
 int
 spawn_launch(char *arg)
 {
-    int pid, ret;
+    int pid, ret, kernel_mode;
     func_p f;
 
     /*
@@ -878,14 +1038,23 @@ spawn_launch(char *arg)
                CURRENT_NAME, getpid(), pid, process_table[CURRENT].ppid,
                (arg ? arg : "NULL"));
 
-    DP(DEBUG3, "%d Going to user mode function\n", getpid());
-    go_user_mode();
+    /* Phase 4's start3() forks the device drivers, so it stays in
+       kernel mode */
+    kernel_mode = (f == start3) && start4;
+    if (!kernel_mode)
+    {
+        DP(DEBUG3, "%d Going to user mode function\n", getpid());
+        go_user_mode();
+    }
 
     /* Begin executing function with supplied argument in user mode */
     ret = f(arg);
 
-    /* Returned from routine.  Terminate. */
-    Terminate(ret);
+    /* Returned from routine.  Terminate: no syscalls in kernel mode. */
+    if (kernel_mode)
+        terminate_real(ret);
+    else
+        Terminate(ret);
 
     DP(DEBUG5,"terminating");
     return 0;
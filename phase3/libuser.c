@@ -258,4 +258,194 @@ void GetPID(int *pid)
     return;
 } /* end of GetPID */
 
+
+/*
+ *  Routine:  SetTickets
+ *
+ *  Description: Set how many tickets a process holds: its share of the
+ *               CPU among processes of the same priority, when the
+ *               kernel is doing stride scheduling.
+ *
+ *  Arguments:    int pid     -- process to set tickets for
+ *                int tickets -- how many, 1 or more
+ *                (output value: completion status)
+ *
+ */
+int SetTickets(int pid, int tickets)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_SETTICKETS;
+    sa.arg1 = (void *) pid;
+    sa.arg2 = (void *) tickets;
+    usyscall(&sa);
+    return (int) sa.arg4;
+} /* end of SetTickets */
+
+
+/*
+ *  Routine:  GetProcStats
+ *
+ *  Description: Get a process's scheduling statistics: time spent ready
+ *               and blocked (by reason), voluntary and involuntary
+ *               switches, and a histogram of how long it took to run
+ *               once unblocked.  See phase1.h.
+ *
+ *  Arguments:    int pid           -- process to get statistics for
+ *                proc_stats *stats -- where to put them
+ *                (output value: completion status)
+ *
+ */
+int GetProcStats(int pid, proc_stats *stats)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_PROCSTATS;
+    sa.arg1 = (void *) pid;
+    sa.arg2 = (void *) stats;
+    usyscall(&sa);
+    return (int) sa.arg4;
+} /* end of GetProcStats */
+
+
+/*
+ *  Routine:  RtReserve
+ *
+ *  Description: Take an EDF reservation for the calling process: it
+ *               gets 'budget' microseconds of CPU every 'period', ahead
+ *               of processes of its priority without one.  A period of
+ *               0 gives the reservation up.
+ *
+ *  Arguments:    int period -- in microseconds, or 0
+ *                int budget -- in microseconds, 1 to period
+ *                (output value: completion status: -1 bad arguments,
+ *                 -2 not enough CPU left to promise)
+ *
+ */
+int RtReserve(int period, int budget)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_RTRESERVE;
+    sa.arg1 = (void *) period;
+    sa.arg2 = (void *) budget;
+    usyscall(&sa);
+    return (int) sa.arg4;
+} /* end of RtReserve */
+
+
+/*
+ *  Routine:  Mbox_Create
+ *
+ *  Description: This is the call entry point to create a new mail box.
+ *
+ *  Arguments:    int   numslots -- number of mailbox slots
+ *                int   slotsize -- size of the mailbox buffer
+ *                int  *mid      -- pointer to output value
+ *                (output value: id of created mailbox)
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int Mbox_Create(int numslots, int slotsize, int *mid)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_MBOXCREATE;
+    sa.arg1 = (void *) numslots;
+    sa.arg2 = (void *) slotsize;
+    usyscall(&sa);
+    *mid = (int) sa.arg1;
+    return (int) sa.arg4;
+} /* end of Mbox_Create */
+
+/*
+ *  Routine:  Mbox_Release
+ *
+ *  Description: This is the call entry point to release a mailbox
+ *
+ *  Arguments: int mbox  -- id of the mailbox
+ *
+ *  Return Value: 0 means success, -1 means error occurs
+ *
+ */
+int Mbox_Release(int mbox)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_MBOXRELEASE;
+    sa.arg1 = (void *) mbox;
+    usyscall(&sa);
+    return (int) sa.arg4;
+} /* end of Mbox_Release */
+
+/*
+ *  Routine:  Mbox_SendMany
+ *
+ *  Description: This is the call entry point for sending a batch of
+ *               messages to a mailbox in one system call.  Blocks as
+ *               Mbox_Send would whenever the mailbox is full.
+ *
+ *  Arguments:    int mbox    -- id of the mailbox to send to
+ *                int count   -- number of messages
+ *                int stride  -- bytes from the start of one message
+ *                               to the next
+ *                int *sizes  -- size of each message
+ *                void* msgs  -- messages to send
+ *
+ *  Return Value: number of messages sent, or negative if none were
+ *
+ */
+int Mbox_SendMany(int mbox, int count, int stride, int *sizes, void *msgs)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_MBOXSENDMANY;
+    sa.arg1 = (void *) mbox;
+    sa.arg2 = msgs;
+    sa.arg3 = (void *) stride;
+    sa.arg4 = (void *) sizes;
+    sa.arg5 = (void *) count;
+    usyscall(&sa);
+    return (int) sa.arg4;
+} /* end of Mbox_SendMany */
+
+/*
+ *  Routine:  Mbox_ReceiveMany
+ *
+ *  Description: This is the call entry point for receiving a batch of
+ *               messages from a mailbox in one system call.  Blocks
+ *               until there is a message, then takes up to count - 1
+ *               more that are already waiting.
+ *
+ *  Arguments:    int mbox    -- id of the mailbox to receive from
+ *                int count   -- most messages to receive
+ *                int stride  -- size of each message buffer
+ *                int *sizes  -- location to put each message's size
+ *                void* msgs  -- location to receive messages
+ *
+ *  Return Value: number of messages received, or negative if none were
+ *
+ */
+int Mbox_ReceiveMany(int mbox, int count, int stride, int *sizes, void *msgs)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_MBOXRECEIVEMANY;
+    sa.arg1 = (void *) mbox;
+    sa.arg2 = msgs;
+    sa.arg3 = (void *) stride;
+    sa.arg4 = (void *) sizes;
+    sa.arg5 = (void *) count;
+    usyscall(&sa);
+    return (int) sa.arg4;
+} /* end of Mbox_ReceiveMany */
+
 /* end libuser.c */
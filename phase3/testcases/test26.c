@@ -0,0 +1,87 @@
+/* SetTickets(), RtReserve() and GetProcStats(): good and bad arguments,
+ * a child can't reserve more CPU than start3 left over, and a child that
+ * blocks on a semaphore shows up in its statistics as having been
+ * blocked and switched out voluntarily. */
+
+#include <stdio.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+
+int Child1(char *);
+int Child2(char *);
+int sem1;
+
+
+int start3(char *arg)
+{
+   int pid, kidpid, status, result;
+   proc_stats stats;
+
+   printf("start3(): started\n");
+   GetPID(&pid);
+
+   result = SetTickets(pid, 4);
+   printf("start3(): SetTickets(self, 4) returned %d\n", result);
+   result = SetTickets(pid, 0);
+   printf("start3(): SetTickets(self, 0) returned %d\n", result);
+   result = SetTickets(MAXPROC * 10, 4);
+   printf("start3(): SetTickets(bad pid, 4) returned %d\n", result);
+
+   result = RtReserve(100000, 20000);
+   printf("start3(): RtReserve(100000, 20000) returned %d\n", result);
+   Spawn("Child2", Child2, NULL, USLOSS_MIN_STACK, 2, &kidpid);
+   Wait(&kidpid, &status);
+   result = RtReserve(100000, 200000);
+   printf("start3(): RtReserve(100000, 200000) returned %d\n", result);
+   result = RtReserve(0, 0);
+   printf("start3(): RtReserve(0, 0) returned %d\n", result);
+
+   result = GetProcStats(pid, &stats);
+   printf("start3(): GetProcStats(self) returned %d\n", result);
+   printf("start3(): cpu_time > 0: %s\n", stats.cpu_time > 0 ? "yes" : "no");
+   result = GetProcStats(pid, NULL);
+   printf("start3(): GetProcStats(self, NULL) returned %d\n", result);
+   result = GetProcStats(MAXPROC * 10, &stats);
+   printf("start3(): GetProcStats(bad pid) returned %d\n", result);
+
+   SemCreate(0, &sem1);
+   Spawn("Child1", Child1, NULL, USLOSS_MIN_STACK, 2, &kidpid);
+
+   /* Child1 ran first, at the higher priority, and is blocked on sem1 */
+   result = GetProcStats(kidpid, &stats);
+   printf("start3(): GetProcStats(Child1) returned %d\n", result);
+   printf("start3(): Child1 voluntary switches = %d\n",
+          stats.voluntary_switches);
+   printf("start3(): Child1 blocked > 0 us: %s\n",
+          stats.blocked_time[STAT_BLOCK_MBOX] > 0 ? "yes" : "no");
+
+   SemV(sem1);
+   Wait(&kidpid, &status);
+   printf("start3(): Child1 done, status = %d\n", status);
+
+   Terminate(0);
+   return 0;
+}
+
+int Child1(char *arg)
+{
+   printf("Child1(): starting, blocking on sem1\n");
+   SemP(sem1);
+   printf("Child1(): done\n");
+   Terminate(3);
+   return 0;
+}
+
+int Child2(char *arg)
+{
+   int result;
+
+   result = RtReserve(100000, 90000);
+   printf("Child2(): RtReserve(100000, 90000) returned %d\n", result);
+   result = RtReserve(100000, 50000);
+   printf("Child2(): RtReserve(100000, 50000) returned %d\n", result);
+   Terminate(4);
+   return 0;
+}
@@ -0,0 +1,82 @@
+/* Mbox_SendMany() and Mbox_ReceiveMany(): a batch of three messages of
+ * different sizes goes through a mailbox in one call each way, and a
+ * receiver blocked for a batch gets what's sent after it blocks.  A
+ * stride of 0 is turned down both ways, without blocking. */
+
+#include <stdio.h>
+#include <string.h>
+#include <usloss.h>
+#include <phase1.h>
+#include <phase2.h>
+#include <libuser.h>
+
+#define STRIDE 16
+
+int Child1(char *);
+int mbox;
+
+
+int start3(char *arg)
+{
+   char msgs[3][STRIDE];
+   int sizes[3];
+   int i, kidpid, status, result;
+
+   printf("start3(): started\n");
+
+   result = Mbox_Create(5, STRIDE, &mbox);
+   printf("start3(): Mbox_Create returned %d\n", result);
+
+   strcpy(msgs[0], "one");
+   strcpy(msgs[1], "three");
+   strcpy(msgs[2], "fifteen");
+   for (i = 0; i < 3; i++)
+      sizes[i] = strlen(msgs[i]) + 1;
+
+   result = Mbox_SendMany(mbox, 3, STRIDE, sizes, msgs);
+   printf("start3(): Mbox_SendMany returned %d\n", result);
+
+   memset(msgs, 0, sizeof(msgs));
+   memset(sizes, 0, sizeof(sizes));
+   result = Mbox_ReceiveMany(mbox, 3, STRIDE, sizes, msgs);
+   printf("start3(): Mbox_ReceiveMany returned %d\n", result);
+   for (i = 0; i < result; i++)
+      printf("start3(): message %d, size %d: `%s'\n", i, sizes[i], msgs[i]);
+
+   Spawn("Child1", Child1, NULL, USLOSS_MIN_STACK, 2, &kidpid);
+
+   /* Child1 is blocked in Mbox_ReceiveMany() now */
+   result = Mbox_SendMany(mbox, 2, STRIDE, sizes, msgs);
+   printf("start3(): Mbox_SendMany returned %d\n", result);
+
+   Wait(&kidpid, &status);
+   printf("start3(): Child1 done, status = %d\n", status);
+
+   result = Mbox_ReceiveMany(mbox, 3, 0, sizes, msgs);
+   printf("start3(): Mbox_ReceiveMany with stride 0 returned %d\n", result);
+   result = Mbox_SendMany(mbox, 3, 0, sizes, msgs);
+   printf("start3(): Mbox_SendMany with stride 0 returned %d\n", result);
+
+   result = Mbox_Release(mbox);
+   printf("start3(): Mbox_Release returned %d\n", result);
+   result = Mbox_SendMany(mbox, 1, STRIDE, sizes, msgs);
+   printf("start3(): Mbox_SendMany to released box returned %d\n", result);
+
+   Terminate(0);
+   return 0;
+}
+
+int Child1(char *arg)
+{
+   char msgs[4][STRIDE];
+   int sizes[4];
+   int i, result;
+
+   printf("Child1(): starting\n");
+   result = Mbox_ReceiveMany(mbox, 4, STRIDE, sizes, msgs);
+   printf("Child1(): Mbox_ReceiveMany returned %d\n", result);
+   for (i = 0; i < result; i++)
+      printf("Child1(): message %d, size %d: `%s'\n", i, sizes[i], msgs[i]);
+   Terminate(4);
+   return 0;
+}
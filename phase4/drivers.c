@@ -18,6 +18,7 @@
 #include <phase2.h>
 #include <phase3.h>
 #include <usloss.h>
+#include <trace.h>
 
 #include <stdlib.h>                 /* atoi */
 
@@ -193,6 +194,7 @@ handle_read_or_write
             INT_TO_POINTER(disk_op.reg1, track);
             disk_op.reg2 = NULL;
 
+            TRACE_EVENT(TRACE_DISK, TRACE_DISK_OP(unit, DISK_SEEK), track);
             ret = device_output(DISK_DEV, unit, &disk_op);
             DISK_ERR(ret, DEV_OK, status,
                      "failed while seeking to %d on disk %d\n", track, unit);
@@ -211,6 +213,8 @@ handle_read_or_write
         disk_op.opr  = request->request_type;
         INT_TO_POINTER(disk_op.reg1, sector_within_track);
         INT_TO_POINTER(disk_op.reg2, request->buffer + (i * DISK_SECTOR_SIZE));
+        TRACE_EVENT(TRACE_DISK, TRACE_DISK_OP(unit, disk_op.opr),
+                    sector_within_track);
         ret = device_output(DISK_DEV, unit, &disk_op);
         DISK_ERR(ret, DEV_OK, status,"Handling disk %d request: %d\n", unit, ret);
 
@@ -347,6 +351,7 @@ disk_driver(char *arg)
     proc_table_entry *entry, *p;
     disk_request_t *request;
 
+    TRACE_EVENT(TRACE_DISK, TRACE_DISK_OP(unit, DISK_TRACKS), 0);
     ret = device_output(DISK_DEV, unit, &disk_op);
     if (ret != DEV_READY)
         KERNEL_ERROR("Couldn't determine disk geometry for disk %d\n", unit);
@@ -499,7 +504,10 @@ terminal_receiver(char *arg)
     int to_syscall  = term_info[unit].rx_syscall_box,
         from_rx     = term_info[unit].rx_box;
 
-    char data;
+    int c, count;
+    int sizes[MAXLINE];
+
+    char data[MAXLINE];
     char line[MAXLINE];
     char garbage[MAXLINE];
 
@@ -508,65 +516,73 @@ terminal_receiver(char *arg)
 
     do
     {
-        /* new data from terminal device */
-        ret = MboxReceive(from_rx , &data, sizeof(data));
-        HANDLE_ZAPPING(ret, status, EZAPPED);
-        TERM_ERR(ret, sizeof(data), status,
+        /* new data from terminal device: whatever has piled up, in one go */
+        count = MboxReceiveMany(from_rx, data, sizeof(data[0]), sizes,
+                                MAXLINE);
+        HANDLE_ZAPPING(count, status, EZAPPED);
+        TERM_ERR((count > 0), 1, status,
                  "term %d badness receiving from box %d: %d\n",
-                 unit, from_rx, ret);
+                 unit, from_rx, count);
 
-        DP(DEBUG4, "term %d receiver got '%c' for position %d\n",
-                   unit, data, position);
+        for (c = 0; c < count; ++c)
+        {
+            TERM_ERR(sizes[c], sizeof(data[0]), status,
+                     "term %d bad char size from box %d: %d\n",
+                     unit, from_rx, sizes[c]);
 
-        /* buffer up to a line of data */
-        line[position] = data;
-        ++position;
+            DP(DEBUG4, "term %d receiver got '%c' for position %d\n",
+                       unit, data[c], position);
 
-        if ((data == '\n') || (position == MAXLINE))
-        {
-            /* End of line.  Send data */
-            DP(DEBUG4,"term %d end of line at position %d\n", unit, position);
-            DP(DEBUG4, "term %d sending the following string: '", unit);
-/*
-            for (i = 0; i < position; ++i)
-            {
-                console("%c", line[i]);
-            }
-            console("'\n");
-*/
-            ret = MboxCondSend(to_syscall, line, position);
-            HANDLE_ZAPPING(ret, status, EZAPPED);
+            /* buffer up to a line of data */
+            line[position] = data[c];
+            ++position;
 
-            /* Nothing quit like being diligent about handling errors
-             * in C, is there? Fucking whee. */
-            switch (ret)
+            if ((data[c] == '\n') || (position == MAXLINE))
             {
-            case -EWOULDBLOCK:
-
-                /* buffer full.  Do read to erase data.  Then do send. */
-                ret = MboxReceive(to_syscall, garbage, sizeof(garbage));
-                HANDLE_ZAPPING(ret, status, EZAPPED);
-                if ((ret < 0) || (ret > MAXLINE))
+                /* End of line.  Send data */
+                DP(DEBUG4,"term %d end of line at position %d\n", unit, position);
+                DP(DEBUG4, "term %d sending the following string: '", unit);
+/*
+                for (i = 0; i < position; ++i)
                 {
-                    DP(DEBUG, "term %d clearing old line of data: %d\n",
-                               unit, ret);
+                    console("%c", line[i]);
                 }
-
-                ret = MboxSend(to_syscall, line, position);
+                console("'\n");
+*/
+                ret = MboxCondSend(to_syscall, line, position);
                 HANDLE_ZAPPING(ret, status, EZAPPED);
-                TERM_ERR(ret, EOKAY, status,
-                               "term %d sending buffered line: %d\n", unit,ret);
-                break;
 
-            default:
-                TERM_ERR(ret, EOKAY, status,
-                           "term %d sending buffered data: %d\n", unit, ret);
-            }
+                /* Nothing quit like being diligent about handling errors
+                 * in C, is there? Fucking whee. */
+                switch (ret)
+                {
+                case -EWOULDBLOCK:
 
-            /* starting a new line */
-            position = 0;
+                    /* buffer full.  Do read to erase data.  Then do send. */
+                    ret = MboxReceive(to_syscall, garbage, sizeof(garbage));
+                    HANDLE_ZAPPING(ret, status, EZAPPED);
+                    if ((ret < 0) || (ret > MAXLINE))
+                    {
+                        DP(DEBUG, "term %d clearing old line of data: %d\n",
+                                   unit, ret);
+                    }
+
+                    ret = MboxSend(to_syscall, line, position);
+                    HANDLE_ZAPPING(ret, status, EZAPPED);
+                    TERM_ERR(ret, EOKAY, status,
+                                   "term %d sending buffered line: %d\n", unit,ret);
+                    break;
+
+                default:
+                    TERM_ERR(ret, EOKAY, status,
+                               "term %d sending buffered data: %d\n", unit, ret);
+                }
+
+                /* starting a new line */
+                position = 0;
+            }
+            /* not end of line of data (anymore).  Keep going. */
         }
-        /* not end of line of data (anymore).  Keep going. */
     } while (!is_zapped());
 
     status = EOKAY;
@@ -648,6 +664,7 @@ terminal_transmitter(char *arg)
                      "term %d getting Tx<->int mutex ID %d: %d",
                      unit, mutex_ID,ret);
 
+            request->data = line.buffer[i];
             request->data_valid = 1;                    /* indicate freshness */
             process_table[CURRENT].pid = getpid();      /* oh yeah... */
             request->process = &process_table[CURRENT]; /* who to wake up */
@@ -828,8 +845,8 @@ handle_tx_stuff(int tx_status, int unit)
                     ret = MboxSend(process->box_ID, 0, 0);
                     HANDLE_ZAPPING(ret, status, EZAPPED);
 
-                    DP(DEBUG, "term %d acking tx to box %d for pid %d\n",
-                              unit, process->box_ID, process->pid);
+                    DP(DEBUG, "term %d acking tx of '%c' to box %d for pid %d\n",
+                              unit, data, process->box_ID, process->pid);
             }
             /* else nothing waiting to be transmitted */
             break;
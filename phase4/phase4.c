@@ -27,8 +27,9 @@
 /* Macros                                                                     */
 /******************************************************************************/
 
-/* Unit names can be this long based on MAX_UNITS */
-#define UNIT_STRING_LENGTH (MAX_UNITS / 10)
+/* Unit names can be this long based on MAX_UNITS: one digit, plus one
+ * more per power of ten */
+#define UNIT_STRING_LENGTH (MAX_UNITS / 10 + 1)
 #define DEVICE_DRIVER_PRIO 2
 #define LINES_TO_BUFFER 10
 
@@ -467,7 +468,7 @@ initialize_process_entry(int index)
     process_table[index].disk_request.first = -1;
     process_table[index].disk_request.sectors = -1;
 
-    process_table[index].result = NULL;
+    process_table[index].result = 0;
 }
 
 /*!
@@ -515,6 +516,7 @@ initialize_clock_data(void)
         KERNEL_ERROR("Creating mailbox for clock driver %d", ret);
 
     DP(DEBUG3, "Mutex for clock is %3d\n", ret);
+    (void)MboxInherit(ret);
 
     clock_info.mutex_ID = ret;
     clock_info.front = NULL;
@@ -546,6 +548,7 @@ initialize_disk_data(void)
         if (ret < 0)
             KERNEL_ERROR("Creating mutex for disk %d: %d", i, ret);
         disk_info[i].mutex_ID = ret;
+        (void)MboxInherit(ret);
 
         DP(DEBUG3,"Disk %d work queue mutex ID %3d\n", i, ret);
 
@@ -594,6 +597,7 @@ initialize_term_data(void)
         if (ret < 0)
             KERNEL_ERROR("Creating Tx box for term %d: %d", i, ret);
         term_info[i].tx_box = ret;
+        (void)MboxInherit(ret);
         DP(DEBUG3, "Term %d tx_box is %d\n", i, ret);
 
         /* mailbox for Tx<->syscall processes */
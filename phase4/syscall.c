@@ -456,6 +456,12 @@ disk_size_real(int unit)
     process_table[CURRENT].pid = getpid();
     add_to_disk_list(&process_table[CURRENT], unit);
 
+    /* Wake up disk, as disk_stuff_real() does: it may be asleep
+     * waiting for a request already. */
+    ret = MboxCondSend(disk_info[unit].box_ID, 0, 0);
+    if ((ret != EOKAY) && (ret != -EWOULDBLOCK))
+        DP(DEBUG, "Waking disk %d: %d\n", unit, ret);
+
     /* block until request serviced  */
     ret = MboxReceive(process_table[CURRENT].box_ID, 0, 0);
     if (ret == EOKAY)
@@ -510,6 +516,10 @@ term_read_real(int unit, int buffer_size, void *buffer)
     memcpy(buffer, local_buffer, copy_size);
     memset(local_buffer, 0, sizeof(local_buffer));
 
+    /* The tests print what they read with %s: end it if there's room */
+    if (copy_size < buffer_size)
+        ((char *)buffer)[copy_size] = '\0';
+
     DP(DEBUG4, "Read completed for %d (really %d) bytes on term %d\n'",
                copy_size, ret, unit);
 /*
@@ -24,8 +24,7 @@ int start4(char *arg)
   assert(j == -1);
   j = TermWrite(b, 13, -1, &len);
   assert(j == -1);
-  console("start4(): Done with test of illegal terminal parameters: %d %d\n",
-          i, j);
+  console("start4(): Done with test of illegal terminal parameters.\n");
   Terminate(3);
 
   return 0;
@@ -94,6 +94,7 @@ typedef struct _data_line_struct
 
 typedef struct _term_request_struct
 {
+    unsigned char data;         /* the character going out */
     int data_valid;             /* how to avoid stale data */
     proc_table_entry *process;  /* who is doing the transmitting */
 } term_request_t;
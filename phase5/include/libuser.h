@@ -5,6 +5,8 @@
 #ifndef _LIBUSER_H
 #define _LIBUSER_H
 
+#include <phase1.h>      /* proc_stats */
+
 /* Phase 3 -- User Function Prototypes */
 extern int  Spawn(char *name, int (*func)(char *), char *arg, int stack_size,
                   int priority, int *pid);
@@ -17,6 +19,9 @@ extern int  SemCreate(int value, int *semaphore);
 extern int  SemP(int semaphore);
 extern int  SemV(int semaphore);
 extern int  SemFree(int semaphore);
+extern int  SetTickets(int pid, int tickets);
+extern int  GetProcStats(int pid, proc_stats *stats);
+extern int  RtReserve(int period, int budget);
 
 /* Phase 4 -- User Function Prototypes */
 extern int  Sleep(int seconds);
@@ -35,6 +40,10 @@ extern int  Mbox_Send(int mbox, int size, void *msg);
 extern int  Mbox_Receive(int mbox, int size, void *msg);
 extern int  Mbox_CondSend(int mbox, int size, void *msg);
 extern int  Mbox_CondReceive(int mbox, int size, void *msg);
+extern int  Mbox_SendMany(int mbox, int count, int stride, int *sizes,
+                          void *msgs);
+extern int  Mbox_ReceiveMany(int mbox, int count, int stride, int *sizes,
+                             void *msgs);
 
 /* Phase 5 -- User Function Prototypes */
 extern void *VmInit(int mappings, int pages, int frames, int pagers);
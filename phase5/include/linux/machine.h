@@ -0,0 +1,19 @@
+/*
+ *  Machine-dependent definitions for the Linux-hosted USLOSS in
+ *  usloss/.  A context is a ucontext plus the PSR to run it with.
+ */
+
+#if !defined(_machine_h)
+#define _machine_h
+
+#include <ucontext.h>
+
+typedef struct
+{
+	ucontext_t	uc;
+	unsigned int	psr;
+	void		(*func)(void);
+	char		*host_stack;	/* what the ucontext really runs on */
+} context;
+
+#endif	/*  _machine_h */
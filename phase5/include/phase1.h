@@ -31,6 +31,45 @@
 
 #define MAXSYSCALLS 	50
 
+/*
+ * block_me() codes phase 2 uses, so that phase 1 can tell what a process
+ * is waiting on: MBOX_BLOCK_CODE and up is a mailbox, DEVICE_BLOCK_CODE
+ * and up a device (that is, a device's mailbox).
+ */
+
+#define MBOX_BLOCK_CODE		50
+#define DEVICE_BLOCK_CODE	60
+
+/*
+ * Per-process scheduling statistics, from get_proc_stats().  Times are
+ * in microseconds, since fork1().
+ */
+
+#define STAT_BLOCK_JOIN		0	/* in join() */
+#define STAT_BLOCK_ZAP		1	/* in zap() */
+#define STAT_BLOCK_MBOX		2
+#define STAT_BLOCK_DEVICE	3
+#define STAT_BLOCK_OTHER	4	/* any other block_me() code */
+#define STAT_BLOCK_REASONS	5
+
+/*
+ * Wakeup latency, from being unblocked to running: bucket 0 counts 0 us,
+ * bucket i (i > 0) 2^(i - 1) us up to 2^i us.  The last bucket also gets
+ * anything longer.
+ */
+
+#define STAT_LATENCY_BUCKETS	24
+
+typedef struct proc_stats
+{
+    int cpu_time;
+    int ready_time;				/* ready, but not running */
+    int blocked_time[STAT_BLOCK_REASONS];
+    int voluntary_switches;			/* blocked or quit */
+    int involuntary_switches;			/* preempted while ready */
+    int wakeup_latency[STAT_LATENCY_BUCKETS];
+} proc_stats;
+
 
 /*
  * Function prototypes for this phase.
@@ -48,8 +87,13 @@ extern  int             block_me(int block_status);
 extern  int             unblock_proc(int pid);
 extern  int             read_cur_start_time(void);
 extern  void            time_slice(void);
+extern  int             skip_tick(void);
 extern  void            dispatcher(void);
 extern	int		readtime(void);
+extern	int		set_tickets(int pid, int tickets);
+extern	int		rt_reserve(int period, int budget);
+extern	int		lend_priority(int donor_pid, int holder_pid, int mbox_id);
+extern	int		get_proc_stats(int pid, proc_stats *stats);
 
 extern	void		p1_fork(int pid);
 extern	void		p1_quit(int pid);
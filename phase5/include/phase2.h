@@ -32,6 +32,39 @@ extern int MboxCondSend(int mbox_id, void *msg_ptr, int msg_size);
 /* returns 0 if successful, 1 if no msg available, -1 if illegal args */
 extern int MboxCondReceive(int mbox_id, void *msg_ptr, int msg_max_size);
 
+/* returns # of msgs sent, or what MboxSend would if the 1st can't be: msg
+ * i is sizes[i] bytes at (char *)msgs + i * stride */
+extern int MboxSendMany(int mbox_id, void *msgs, int stride, int sizes[],
+                        int count);
+
+/* blocks for the 1st msg, then takes up to count - 1 more that are waiting:
+ * returns # of msgs received, or what MboxReceive would if there were none */
+extern int MboxReceiveMany(int mbox_id, void *msgs, int stride, int sizes[],
+                           int count);
+
+/* MboxSend/MboxReceive, but giving up with -4 if blocked for longer than
+ * timeout usecs (checked each clock interrupt) */
+extern int MboxSendTimed(int mbox_id, void *msg_ptr, int msg_size,
+                         int timeout);
+extern int MboxReceiveTimed(int mbox_id, void *msg_ptr, int msg_max_size,
+                            int timeout);
+
+/* returns 0 if successful, -1 if invalid args: blocked senders lend their
+ * priority to the sender of the oldest message (mutexes, semaphores) */
+extern int MboxInherit(int mbox_id);
+
+/* most mailboxes MboxSelect can wait on at once */
+#define MAX_SELECT      16
+
+/* receives from whichever of box_ids has a msg first, blocking until one
+ * does: returns its index in box_ids (msg's size in *msg_size), -1 if
+ * invalid args, -3 if zapped or the box was released while blocked */
+extern int MboxSelect(int box_ids[], int count, void *msg_ptr,
+                      int msg_max_size, int *msg_size);
+
+/* ID of the mailbox waitdevice(type, unit) waits on, for MboxSelect */
+extern int devicebox(int type, int unit);
+
 /* type = interrupt device type, unit = # of device (when more than one),
  * status = where interrupt handler puts device's status register.
  */
@@ -0,0 +1,57 @@
+/*
+ * Kernel event tracing: a fixed-size ring of binary records in phase 1,
+ * written at finish() to TRACE_FILE and turned into Chrome trace_event
+ * JSON by phase1/trunk/tools/trace2json.
+ *
+ * Build with -DKERNEL_TRACE to turn it on.  Without it TRACE_EVENT()
+ * is nothing at all.
+ */
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+/* Events, and what arg1 and arg2 are for each */
+#define TRACE_SWITCH    1   /* old pid, new pid */
+#define TRACE_BLOCK     2   /* block code, 0 */
+#define TRACE_UNBLOCK   3   /* pid unblocked, 0 */
+#define TRACE_SEND      4   /* mailbox ID, message size */
+#define TRACE_RECEIVE   5   /* mailbox ID, message size or error */
+#define TRACE_FAULT     6   /* offset into VM region, MMU cause */
+#define TRACE_DISK      7   /* TRACE_DISK_OP(unit, opr), track or sector */
+#define TRACE_EVENTS    8
+
+#define TRACE_DISK_OP(unit, opr)    (((unit) << 8) | (opr))
+#define TRACE_DISK_UNIT(a)          ((a) >> 8)
+#define TRACE_DISK_OPR(a)           ((a) & 0xff)
+
+/* Records in the ring: a power of 2 */
+#define TRACE_RECORDS   8192
+
+#define TRACE_FILE      "trace.bin"
+#define TRACE_MAGIC     "USLTRACE"
+
+typedef struct
+{
+    int   time;             /* sys_clock() */
+    short pid;              /* Current, 0 before there is one */
+    short event;
+    int   arg1;
+    int   arg2;
+} trace_record;
+
+/* TRACE_FILE is this, then 'records' trace_records, oldest first */
+typedef struct
+{
+    char         magic[8];
+    unsigned int records;
+    unsigned int dropped;   /* overwritten before the dump */
+} trace_header;
+
+#ifdef KERNEL_TRACE
+extern void trace_event(int event, int arg1, int arg2);
+#define TRACE_EVENT(event, arg1, arg2) trace_event(event, arg1, arg2)
+#else
+#define TRACE_EVENT(event, arg1, arg2) do { } while (0)
+#endif
+
+#endif /* _TRACE_H */
@@ -49,6 +49,13 @@
 
 #endif
 
+/* Our own additions: kept clear of the extra credit numbers above */
+#define SYS_SETTICKETS          30
+#define SYS_PROCSTATS           31
+#define SYS_MBOXSENDMANY        32
+#define SYS_MBOXRECEIVEMANY     33
+#define SYS_RTRESERVE           34
+
 
 /*  The sysargs structure */
 /* -- Now defined in phase2.h, not here...
@@ -65,5 +72,9 @@ typedef struct sysargs
 
 extern void usyscall(sysargs *sa);
 
+/* The Linux-hosted USLOSS's stand-in for the sysargs pointer that
+ * USLOSS passes the syscall handler as 'unit': see usloss/machine.c */
+extern sysargs *usyscall_args(void);
+
 #endif	/*  _SYSCALL_H */
 
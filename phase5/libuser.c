@@ -602,6 +602,72 @@ int Mbox_CondReceive(int mbox, int size, void *msg)
 } /* end of Mbox_CondReceive */
 
 
+/*
+ *  Routine:  Mbox_SendMany
+ *
+ *  Description: This is the call entry point for sending a batch of
+ *               messages to a mailbox in one system call.  Blocks as
+ *               Mbox_Send would whenever the mailbox is full.
+ *
+ *  Arguments:    int mbox    -- id of the mailbox to send to
+ *                int count   -- number of messages
+ *                int stride  -- bytes from the start of one message
+ *                               to the next
+ *                int *sizes  -- size of each message
+ *                void* msgs  -- messages to send
+ *
+ *  Return Value: number of messages sent, or negative if none were
+ *
+ */
+int Mbox_SendMany(int mbox, int count, int stride, int *sizes, void *msgs)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_MBOXSENDMANY;
+    sa.arg1 = (void *) mbox;
+    sa.arg2 = msgs;
+    sa.arg3 = (void *) stride;
+    sa.arg4 = (void *) sizes;
+    sa.arg5 = (void *) count;
+    usyscall(&sa);
+    return (int) sa.arg4;
+} /* end of Mbox_SendMany */
+
+
+/*
+ *  Routine:  Mbox_ReceiveMany
+ *
+ *  Description: This is the call entry point for receiving a batch of
+ *               messages from a mailbox in one system call.  Blocks
+ *               until there is a message, then takes up to count - 1
+ *               more that are already waiting.
+ *
+ *  Arguments:    int mbox    -- id of the mailbox to receive from
+ *                int count   -- most messages to receive
+ *                int stride  -- size of each message buffer
+ *                int *sizes  -- location to put each message's size
+ *                void* msgs  -- location to receive messages
+ *
+ *  Return Value: number of messages received, or negative if none were
+ *
+ */
+int Mbox_ReceiveMany(int mbox, int count, int stride, int *sizes, void *msgs)
+{
+    sysargs sa;
+
+    CHECKMODE;
+    sa.number = SYS_MBOXRECEIVEMANY;
+    sa.arg1 = (void *) mbox;
+    sa.arg2 = msgs;
+    sa.arg3 = (void *) stride;
+    sa.arg4 = (void *) sizes;
+    sa.arg5 = (void *) count;
+    usyscall(&sa);
+    return (int) sa.arg4;
+} /* end of Mbox_ReceiveMany */
+
+
 /*
  *  Routine:  VmInit
  *
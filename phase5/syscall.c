@@ -17,6 +17,7 @@
 #include <usyscall.h>
 #include <phase1.h>             /* int_vec */
 #include <phase5.h>             /* MMU_* */
+#include <trace.h>              /* TRACE_EVENT */
 #include <provided_prototypes.h>/* terminate_real(), wait_real() */
 
 #include <string.h>             /* memset */
@@ -237,8 +238,7 @@ MMU_handler(int source, int offset)
     fault.cause = MMU_GetCause();
     fault.offset = offset;
 
-    DP(DEBUG3, "fault pid %d offset %08x source %d.  Enqueueing\n",
-               fault.pid, fault.offset, fault.cause);
+    TRACE_EVENT(TRACE_FAULT, offset, fault.cause);
 
     ret = MboxSend(fault_handler_queue, &fault, sizeof(fault));
     if (ret != 0)
@@ -0,0 +1,388 @@
+/*!
+    Author: Robert Crocombe
+    Class: CS452 Operating Systems Spring 2005
+
+    Simulated devices for the host USLOSS: see machine.c.  All times
+    here are sys_clock() times.
+
+    Clock: interrupts every CLOCK_MS.  Its status is the time.
+
+    Alarm: device_output() with a number of us raises one interrupt
+    that much later.
+
+    Disks: unit N is the file "diskN" in the current directory, made
+    (sparse) with DISK_DEFAULT_TRACKS tracks if it isn't there.  It's
+    opened the first time the disk is used, so phases without disks
+    don't leave disk files lying around.
+    Requests take effect right away, but the interrupt saying they're
+    done comes DISK_OP_US later, plus DISK_TRACK_US per track for
+    seeks.  The status is DEV_BUSY until then.
+
+    Terminals: unit N reads from "termN.in", if there is one, and
+    writes to "termN.out".  Every TERM_CHAR_US a terminal takes in a
+    character (if receive interrupts are on and there's input left) and
+    finishes sending the last one; it interrupts if it got a character
+    or if transmit interrupts are on and it's ready to send.  Reading
+    the status takes the received character.
+*/
+
+#include <usloss.h>
+
+#include "sim.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct
+{
+    int opened;
+    int fd;
+    int tracks;
+    int track;          /* where the head is */
+    int status;
+    int done_at;        /* NO_EVENT unless busy */
+} disk_unit;
+
+typedef struct
+{
+    int in_fd;          /* -1 once input runs out */
+    int out_fd;
+    int recv;           /* DEV_BUSY: 'ch' has a character */
+    int xmit;           /* DEV_BUSY: still sending */
+    int ch;
+    int recv_int;
+    int xmit_int;
+    int next_at;
+} term_unit;
+
+static int next_tick;
+static int alarm_at = NO_EVENT;
+static disk_unit disks[DISK_UNITS];
+static term_unit terms[TERM_UNITS];
+
+static disk_unit *
+open_disk(int unit)
+{
+    char name[16];
+    struct stat st;
+    disk_unit *d = disks + unit;
+    const int track_bytes = DISK_SECTOR_SIZE * DISK_TRACK_SIZE;
+
+    if (d->opened)
+        return d;
+    d->opened = 1;
+
+    sprintf(name, "disk%d", unit);
+    d->fd = open(name, O_RDWR | O_CREAT, 0644);
+    d->status = DEV_READY;
+    d->done_at = NO_EVENT;
+
+    if ((d->fd < 0) || (fstat(d->fd, &st) < 0))
+    {
+        console("USLOSS: can't open disk file '%s'\n", name);
+        d->fd = -1;
+        return d;
+    }
+
+    if (st.st_size == 0)
+    {
+        st.st_size = (off_t)DISK_DEFAULT_TRACKS(unit) * track_bytes;
+        if (ftruncate(d->fd, st.st_size) < 0)
+            console("USLOSS: can't size disk file '%s'\n", name);
+    }
+
+    d->tracks = st.st_size / track_bytes;
+    return d;
+}
+
+static void
+open_term(int unit)
+{
+    char name[16];
+    term_unit *t = terms + unit;
+
+    sprintf(name, "term%d.in", unit);
+    t->in_fd = open(name, O_RDONLY);
+
+    sprintf(name, "term%d.out", unit);
+    t->out_fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    t->recv = DEV_READY;
+    t->xmit = DEV_READY;
+    t->next_at = TERM_CHAR_US;
+}
+
+void
+sim_devices_init(void)
+{
+    int i;
+
+    next_tick = CLOCK_MS * 1000;
+
+    for (i = 0; i < DISK_UNITS; ++i)
+        disks[i].done_at = NO_EVENT;
+
+    for (i = 0; i < TERM_UNITS; ++i)
+        open_term(i);
+}
+
+/*!
+    Does the terminal have anything to do at its next event?
+*/
+
+static int
+term_active(term_unit *t)
+{
+    return t->xmit_int || (t->xmit == DEV_BUSY)
+        || (t->recv_int && (t->in_fd >= 0) && (t->recv == DEV_READY));
+}
+
+/*!
+    The terminal's character time has come around.  Returns 1 if it
+    should interrupt.
+*/
+
+static int
+term_event(term_unit *t)
+{
+    char c;
+    int got = 0;
+
+    t->xmit = DEV_READY;
+
+    if (t->recv_int && (t->in_fd >= 0) && (t->recv == DEV_READY))
+    {
+        if (read(t->in_fd, &c, 1) == 1)
+        {
+            t->ch = (unsigned char)c;
+            t->recv = DEV_BUSY;
+            got = 1;
+        }
+        else
+        {
+            close(t->in_fd);
+            t->in_fd = -1;
+        }
+    }
+
+    return got || t->xmit_int;
+}
+
+/*!
+    If some device has an interrupt due at 'now', say which one and
+    return 1, else 0.  The event is used up either way: an interrupt
+    that's due while they're disabled is taken when they come back on.
+*/
+
+int
+sim_next_due(int now, int *dev, int *unit)
+{
+    int i;
+    term_unit *t;
+
+    if (now >= next_tick)
+    {
+        /* Missed ticks (interrupts off too long) don't pile up */
+        while (next_tick <= now)
+            next_tick += CLOCK_MS * 1000;
+        *dev = CLOCK_DEV;
+        *unit = 0;
+        return 1;
+    }
+
+    if (now >= alarm_at)
+    {
+        alarm_at = NO_EVENT;
+        *dev = ALARM_DEV;
+        *unit = 0;
+        return 1;
+    }
+
+    for (i = 0; i < DISK_UNITS; ++i)
+    {
+        if (now >= disks[i].done_at)
+        {
+            disks[i].done_at = NO_EVENT;
+            if (disks[i].status == DEV_BUSY)
+                disks[i].status = DEV_READY;
+            *dev = DISK_DEV;
+            *unit = i;
+            return 1;
+        }
+    }
+
+    for (i = 0; i < TERM_UNITS; ++i)
+    {
+        t = terms + i;
+        if (now < t->next_at)
+            continue;
+
+        /* Character times that went by unnoticed are just gone */
+        t->next_at = now + TERM_CHAR_US;
+        if (term_active(t) && term_event(t))
+        {
+            *dev = TERM_DEV;
+            *unit = i;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*!
+    When the next device event is, for waitint().
+*/
+
+int
+sim_next_event(void)
+{
+    int i;
+    int next = next_tick;
+
+    if (alarm_at < next)
+        next = alarm_at;
+
+    for (i = 0; i < DISK_UNITS; ++i)
+        if (disks[i].done_at < next)
+            next = disks[i].done_at;
+
+    for (i = 0; i < TERM_UNITS; ++i)
+        if (term_active(terms + i) && (terms[i].next_at < next))
+            next = terms[i].next_at;
+
+    return next;
+}
+
+static int
+disk_output(int unit, device_request *req)
+{
+    disk_unit *d = open_disk(unit);
+    const int now = sys_clock();
+    int delay = DISK_OP_US;
+    int distance;
+    off_t where;
+    int ok = 1;
+
+    if ((d->fd < 0) || (d->status == DEV_BUSY))
+        return DEV_INVALID;
+
+    switch (req->opr)
+    {
+    case DISK_SEEK:
+        distance = (int)(long)req->reg1 - d->track;
+        delay += (distance < 0 ? -distance : distance) * DISK_TRACK_US;
+        ok = ((int)(long)req->reg1 >= 0) && ((int)(long)req->reg1 < d->tracks);
+        if (ok)
+            d->track = (int)(long)req->reg1;
+        break;
+
+    case DISK_READ:
+    case DISK_WRITE:
+        ok = ((int)(long)req->reg1 >= 0) && ((int)(long)req->reg1 < DISK_TRACK_SIZE);
+        if (!ok)
+            break;
+        where = ((off_t)d->track * DISK_TRACK_SIZE + (int)(long)req->reg1)
+              * DISK_SECTOR_SIZE;
+        if (req->opr == DISK_READ)
+            ok = pread(d->fd, req->reg2, DISK_SECTOR_SIZE, where) == DISK_SECTOR_SIZE;
+        else
+            ok = pwrite(d->fd, req->reg2, DISK_SECTOR_SIZE, where) == DISK_SECTOR_SIZE;
+        break;
+
+    case DISK_TRACKS:
+        *(int *)req->reg1 = d->tracks;
+        break;
+
+    default:
+        ok = 0;
+    }
+
+    d->status = ok ? DEV_BUSY : DEV_ERROR;
+    d->done_at = now + delay;
+    return DEV_OK;
+}
+
+static void
+term_output(int unit, int ctrl)
+{
+    term_unit *t = terms + unit;
+    char c;
+
+    t->recv_int = (ctrl & 0x2) != 0;
+    t->xmit_int = (ctrl & 0x4) != 0;
+
+    if (ctrl & 0x1)
+    {
+        c = (char)((ctrl >> 8) & 0xff);
+        if (t->out_fd >= 0)
+            (void)!write(t->out_fd, &c, 1);
+        t->xmit = DEV_BUSY;
+    }
+}
+
+int
+device_output(unsigned int dev, int unit, void *arg)
+{
+    switch (dev)
+    {
+    case ALARM_DEV:
+        if (unit != 0)
+            return DEV_INVALID;
+        alarm_at = sys_clock() + (int)(long)arg;
+        return DEV_OK;
+
+    case DISK_DEV:
+        if ((unit < 0) || (unit >= DISK_UNITS))
+            return DEV_INVALID;
+        return disk_output(unit, (device_request *)arg);
+
+    case TERM_DEV:
+        if ((unit < 0) || (unit >= TERM_UNITS))
+            return DEV_INVALID;
+        term_output(unit, (int)(long)arg);
+        return DEV_OK;
+    }
+
+    return DEV_INVALID;
+}
+
+int
+device_input(unsigned int dev, int unit, int *status)
+{
+    term_unit *t;
+
+    switch (dev)
+    {
+    case CLOCK_DEV:
+        if (unit != 0)
+            return DEV_INVALID;
+        *status = sys_clock();
+        return DEV_OK;
+
+    case ALARM_DEV:
+        if (unit != 0)
+            return DEV_INVALID;
+        *status = (alarm_at == NO_EVENT) ? DEV_READY : DEV_BUSY;
+        return DEV_OK;
+
+    case DISK_DEV:
+        if ((unit < 0) || (unit >= DISK_UNITS))
+            return DEV_INVALID;
+        *status = open_disk(unit)->status;
+        return DEV_OK;
+
+    case TERM_DEV:
+        if ((unit < 0) || (unit >= TERM_UNITS))
+            return DEV_INVALID;
+        t = terms + unit;
+        *status = (t->recv == DEV_BUSY ? (t->ch << 8) : 0)
+                | (t->xmit << 2) | t->recv;
+        t->recv = DEV_READY;
+        return DEV_OK;
+    }
+
+    return DEV_INVALID;
+}
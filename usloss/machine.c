@@ -0,0 +1,346 @@
+/*!
+    Author: Robert Crocombe
+    Class: CS452 Operating Systems Spring 2005
+
+    A stand-in for the USLOSS library that runs on a Linux host, so
+    the phases build and run without the class's libusloss.
+
+    Processes are ucontexts.  A context carries its own PSR, which
+    comes back with it when it's switched to.
+
+    sys_clock() is virtual: it runs along with the host's clock while
+    anything is running, but when the kernel waitint()s it jumps
+    straight to the next device event, so an idle kernel costs nothing
+    and tests don't sit around waiting for the clock.
+
+    A host timer (SIGALRM, every SIM_POLL_US) checks the devices.  If
+    anything is due and interrupts are enabled, the interrupt handler
+    is run right there, in the signal handler, on the stack of the
+    process that was interrupted.  A signal frame and printf() on a
+    64-bit host don't leave enough of USLOSS_MIN_STACK for that, so
+    contexts run on host stacks of SIM_STACK_BYTES (see context_init()).
+    Interrupts that come due while they're disabled are delivered as
+    soon as psr_set() turns them back on.
+
+    Devices are in devices.c, the MMU in mmu.c.
+*/
+
+#include <usloss.h>
+#include <phase2.h>
+#include <usyscall.h>
+
+#include "sim.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <time.h>
+
+extern void startup(void);
+extern void finish(void);
+
+void (*int_vec[NUM_INTS])(int dev, int unit);
+
+unsigned int sim_psr = PSR_CURRENT_MODE;
+
+static long long boot_us;       /* host time at startup */
+static long long skipped_us;    /* idle time jumped over by waitint() */
+
+/* The context being switched to, for a new one to find itself */
+static context *starting;
+
+static long long
+host_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void
+block_alarm(sigset_t *old)
+{
+    sigset_t set;
+
+    sigemptyset(&set);
+    sigaddset(&set, SIGALRM);
+    sigprocmask(SIG_BLOCK, &set, old);
+}
+
+static void
+restore_alarm(sigset_t *old)
+{
+    sigprocmask(SIG_SETMASK, old, NULL);
+}
+
+int
+sys_clock(void)
+{
+    return (int)(host_us() - boot_us + skipped_us);
+}
+
+/*!
+    Take an interrupt: current mode and interrupt bits move to the
+    previous ones, and the handler runs in kernel mode with interrupts
+    off.  They come back when it returns.
+*/
+
+void
+sim_interrupt(int dev, int unit)
+{
+    const unsigned int saved = sim_psr;
+
+    sim_psr = ((saved & PSR_CURRENT_MASK) << 2) | PSR_CURRENT_MODE;
+
+    if (int_vec[dev])
+        int_vec[dev](dev, unit);
+    else
+    {
+        console("USLOSS: no handler for interrupt %d unit %d\n", dev, unit);
+        halt(1);
+    }
+
+    sim_psr = saved;
+}
+
+/*!
+    Deliver whatever device interrupts are due, for as long as
+    interrupts stay enabled.
+*/
+
+static void
+poll_interrupts(void)
+{
+    sigset_t old;
+    int dev, unit;
+
+    block_alarm(&old);
+    while ((sim_psr & PSR_CURRENT_INT) && sim_next_due(sys_clock(), &dev, &unit))
+        sim_interrupt(dev, unit);
+    restore_alarm(&old);
+}
+
+static void
+alarm_signal(int sig)
+{
+    if (sim_psr & PSR_CURRENT_INT)
+        poll_interrupts();
+}
+
+unsigned int
+psr_get(void)
+{
+    return sim_psr;
+}
+
+void
+psr_set(unsigned int psr)
+{
+    sim_psr = psr & PSR_MASK;
+
+    if (sim_psr & PSR_CURRENT_INT)
+        poll_interrupts();
+}
+
+/*!
+    Nothing to do until the next device event, so skip ahead to it.
+*/
+
+void
+waitint(void)
+{
+    sigset_t old;
+    int next, now;
+
+    block_alarm(&old);
+    next = sim_next_event();
+    now = sys_clock();
+    if ((next != NO_EVENT) && (next > now))
+        skipped_us += next - now;
+    restore_alarm(&old);
+
+    poll_interrupts();
+}
+
+/*!
+    Where every new context starts.
+*/
+
+static void
+launch_context(void)
+{
+    context *me = starting;
+
+    me->func();
+
+    console("USLOSS: process returned from its start function\n");
+    halt(1);
+}
+
+/*!
+    'stack' is the top (highest address) of the stack, as with USLOSS,
+    but how big it is isn't passed in, and USLOSS_MIN_STACK of it may
+    not be enough here (see above).  So the context runs on a host
+    stack of SIM_STACK_BYTES instead, which 'state' keeps: contexts
+    are reused, kernels keep theirs in zeroed tables, and the stack
+    goes along with the context for the next process.
+*/
+
+void
+context_init(context *state, unsigned int psr, char *stack, void (*func)(void))
+{
+    getcontext(&state->uc);
+
+    if (!state->host_stack)
+    {
+        state->host_stack = malloc(SIM_STACK_BYTES);
+        if (!state->host_stack)
+        {
+            console("USLOSS: no memory for a stack\n");
+            halt(1);
+        }
+    }
+
+    state->uc.uc_stack.ss_sp = state->host_stack;
+    state->uc.uc_stack.ss_size = SIM_STACK_BYTES;
+    state->uc.uc_link = NULL;
+    sigemptyset(&state->uc.uc_sigmask);
+
+    state->psr = psr & PSR_MASK;
+    state->func = func;
+
+    makecontext(&state->uc, launch_context, 0);
+}
+
+/*!
+    Save the running context in 'old' (NULL if there's nothing worth
+    saving, as for the first switch) and run 'new' with its PSR.
+*/
+
+void
+context_switch(context *old, context *new)
+{
+    sigset_t mask;
+
+    block_alarm(&mask);
+
+    starting = new;
+
+    if (!old)
+    {
+        sim_psr = new->psr;
+        setcontext(&new->uc);
+    }
+
+    old->psr = sim_psr;
+    sim_psr = new->psr;
+    swapcontext(&old->uc, &new->uc);
+
+    restore_alarm(&mask);
+}
+
+/*!
+    The syscall interrupt.  USLOSS hands the handler the sysargs pointer
+    as its 'unit', but on a 64-bit host a pointer doesn't fit in an int,
+    so it's left here for the handler to get from usyscall_args()
+    instead, and 'unit' is 0.  The handler runs before anything else
+    can make a syscall, so one pointer is enough.
+*/
+
+static sysargs *syscall_args;
+
+void
+usyscall(sysargs *sa)
+{
+    syscall_args = sa;
+    sim_interrupt(SYS_INT, 0);
+}
+
+sysargs *
+usyscall_args(void)
+{
+    return syscall_args;
+}
+
+void
+console(char *string, ...)
+{
+    va_list ap;
+
+    va_start(ap, string);
+    vconsole(string, ap);
+    va_end(ap);
+}
+
+void
+vconsole(char *string, va_list ap)
+{
+    sigset_t old;
+
+    block_alarm(&old);
+    vfprintf(stdout, string, ap);
+    fflush(stdout);
+    restore_alarm(&old);
+}
+
+void
+trace(char *string, ...)
+{
+    va_list ap;
+
+    va_start(ap, string);
+    vtrace(string, ap);
+    va_end(ap);
+}
+
+void
+vtrace(char *string, va_list ap)
+{
+    sigset_t old;
+
+    block_alarm(&old);
+    vfprintf(stderr, string, ap);
+    restore_alarm(&old);
+}
+
+/*!
+    Calls finish(), as USLOSS does, and exits: non-zero 'dumpcore'
+    exits with 1 rather than leaving cores all over.
+*/
+
+void
+halt(int dumpcore)
+{
+    struct itimerval off = { { 0, 0 }, { 0, 0 } };
+
+    setitimer(ITIMER_REAL, &off, NULL);
+    finish();
+    fflush(stdout);
+    exit(dumpcore ? 1 : 0);
+}
+
+int
+main(int argc, char *argv[])
+{
+    struct sigaction sa;
+    struct itimerval poll = { { 0, SIM_POLL_US }, { 0, SIM_POLL_US } };
+
+    boot_us = host_us();
+    sim_devices_init();
+
+    sa.sa_handler = alarm_signal;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGALRM, &sa, NULL);
+    setitimer(ITIMER_REAL, &poll, NULL);
+
+    /* Kernel mode, interrupts off */
+    sim_psr = PSR_CURRENT_MODE;
+    startup();
+
+    console("USLOSS: startup() returned\n");
+    halt(0);
+    return 0;
+}
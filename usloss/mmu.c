@@ -0,0 +1,362 @@
+/*!
+    Author: Robert Crocombe
+    Class: CS452 Operating Systems Spring 2005
+
+    The MMU for the host USLOSS (see machine.c), done with the host's
+    own MMU.  The VM region is an mmap()ed range of pages, and frames
+    are pages of an anonymous shared file: mapping page P to frame F
+    mmap()s frame F's page of the file at page P of the region.  Only
+    the current tag's mappings are actually in place; MMU_SetTag()
+    swaps them.
+
+    Touching a page that isn't mapped, or that its protection doesn't
+    allow, gets a SIGSEGV, which becomes an MMU_INT interrupt with the
+    offset into the region as the 'unit'.  When the handler returns,
+    the access is tried again.
+
+    Reference and dirty bits are kept by mapping pages with less access
+    than they're allowed: no access until the frame is referenced,
+    read-only until it's written.  The faults that upgrade them never
+    get as far as the interrupt handler.
+*/
+
+#define _GNU_SOURCE     /* memfd_create() */
+
+#include <usloss.h>
+#include <mmu.h>
+
+#include "sim.h"
+
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+typedef struct
+{
+    int mapped;
+    int frame;
+    int prot;
+} mmu_map;
+
+static int initialized;
+static char *region;
+static int page_size;
+static int num_pages, num_frames, max_maps, maps_in_use;
+static int frames_fd = -1;
+static int tag;
+static int cause;
+static mmu_map *maps[MMU_NUM_TAG];
+static int *access_bits;
+static struct sigaction old_segv;
+
+/*!
+    Put 'page' of the current tag in place with as much access as it's
+    allowed and its frame's access bits say it has used.
+*/
+
+static void
+install(int page)
+{
+    mmu_map *m = maps[tag] + page;
+    int prot = PROT_NONE;
+    void *where = region + (long)page * page_size;
+
+    if (!m->mapped)
+    {
+        mmap(where, page_size, PROT_NONE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+        return;
+    }
+
+    if (access_bits[m->frame] & MMU_REF)
+    {
+        if (m->prot == MMU_PROT_READ)
+            prot = PROT_READ;
+        else if (m->prot == MMU_PROT_RW)
+            prot = (access_bits[m->frame] & MMU_DIRTY)
+                 ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    }
+
+    mmap(where, page_size, prot, MAP_SHARED | MAP_FIXED,
+         frames_fd, (off_t)m->frame * page_size);
+}
+
+/*!
+    Re-install every page of the current tag that maps 'frame', after
+    its access bits change.
+*/
+
+static void
+reinstall_frame(int frame)
+{
+    int page;
+
+    for (page = 0; page < num_pages; ++page)
+        if (maps[tag][page].mapped && (maps[tag][page].frame == frame))
+            install(page);
+}
+
+static void
+segv_signal(int sig, siginfo_t *info, void *uc)
+{
+    char *addr = (char *)info->si_addr;
+    mmu_map *m;
+    int page;
+
+    if (!initialized || (addr < region)
+        || (addr >= region + (long)num_pages * page_size))
+    {
+        /* Not ours: a real crash */
+        sigaction(SIGSEGV, &old_segv, NULL);
+        return;
+    }
+
+    page = (addr - region) / page_size;
+    m = maps[tag] + page;
+
+    if (m->mapped && (m->prot != MMU_PROT_NONE))
+    {
+        if (!(access_bits[m->frame] & MMU_REF))
+        {
+            access_bits[m->frame] |= MMU_REF;
+            reinstall_frame(m->frame);
+            return;
+        }
+
+        if ((m->prot == MMU_PROT_RW) && !(access_bits[m->frame] & MMU_DIRTY))
+        {
+            access_bits[m->frame] |= MMU_DIRTY;
+            reinstall_frame(m->frame);
+            return;
+        }
+    }
+
+    cause = m->mapped ? MMU_ACCESS : MMU_FAULT;
+    sim_interrupt(MMU_INT, (int)(addr - region));
+}
+
+int
+MMU_Init(int numMaps, int numPages, int numFrames)
+{
+    struct sigaction sa;
+    int i;
+
+    if (initialized)
+        return MMU_ERR_ON;
+
+    if ((numMaps < 1) || (numPages < 1) || (numFrames < 1))
+        return MMU_ERR_MAPS;
+
+    page_size = sysconf(_SC_PAGESIZE);
+    num_pages = numPages;
+    num_frames = numFrames;
+    max_maps = numMaps;
+    maps_in_use = 0;
+    tag = 0;
+    cause = 0;
+
+    region = mmap(NULL, (long)num_pages * page_size, PROT_NONE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    frames_fd = memfd_create("usloss-frames", 0);
+    if ((region == MAP_FAILED) || (frames_fd < 0)
+        || (ftruncate(frames_fd, (off_t)num_frames * page_size) < 0))
+    {
+        console("USLOSS: can't set up %d pages and %d frames for the MMU\n",
+                numPages, numFrames);
+        halt(1);
+    }
+
+    for (i = 0; i < MMU_NUM_TAG; ++i)
+        maps[i] = calloc(num_pages, sizeof(mmu_map));
+    access_bits = calloc(num_frames, sizeof(int));
+
+    sa.sa_sigaction = segv_signal;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigaction(SIGSEGV, &sa, &old_segv);
+
+    initialized = 1;
+    return MMU_OK;
+}
+
+void *
+MMU_Region(int *numPagesPtr)
+{
+    if (!initialized)
+        return NULL;
+
+    *numPagesPtr = num_pages;
+    return region;
+}
+
+int
+MMU_Done(void)
+{
+    int i;
+
+    if (!initialized)
+        return MMU_ERR_OFF;
+
+    sigaction(SIGSEGV, &old_segv, NULL);
+    munmap(region, (long)num_pages * page_size);
+    close(frames_fd);
+    frames_fd = -1;
+
+    for (i = 0; i < MMU_NUM_TAG; ++i)
+        free(maps[i]);
+    free(access_bits);
+
+    initialized = 0;
+    return MMU_OK;
+}
+
+static int
+check_args(int t, int page)
+{
+    if (!initialized)
+        return MMU_ERR_OFF;
+    if ((t < 0) || (t >= MMU_NUM_TAG))
+        return MMU_ERR_TAG;
+    if ((page < 0) || (page >= num_pages))
+        return MMU_ERR_PAGE;
+    return MMU_OK;
+}
+
+int
+MMU_Map(int t, int page, int frame, int protection)
+{
+    int ret = check_args(t, page);
+
+    if (ret != MMU_OK)
+        return ret;
+    if ((frame < 0) || (frame >= num_frames))
+        return MMU_ERR_FRAME;
+    if (   (protection != MMU_PROT_NONE) && (protection != MMU_PROT_READ)
+        && (protection != MMU_PROT_RW))
+        return MMU_ERR_PROT;
+    if (maps[t][page].mapped)
+        return MMU_ERR_REMAP;
+    if (maps_in_use == max_maps)
+        return MMU_ERR_MAPS;
+
+    maps[t][page].mapped = 1;
+    maps[t][page].frame = frame;
+    maps[t][page].prot = protection;
+    ++maps_in_use;
+
+    if (t == tag)
+        install(page);
+    return MMU_OK;
+}
+
+int
+MMU_Unmap(int t, int page)
+{
+    int ret = check_args(t, page);
+
+    if (ret != MMU_OK)
+        return ret;
+    if (!maps[t][page].mapped)
+        return MMU_ERR_NOMAP;
+
+    maps[t][page].mapped = 0;
+    --maps_in_use;
+
+    if (t == tag)
+        install(page);
+    return MMU_OK;
+}
+
+int
+MMU_GetMap(int t, int page, int *framePtr, int *protPtr)
+{
+    int ret = check_args(t, page);
+
+    if (ret != MMU_OK)
+        return ret;
+    if (!maps[t][page].mapped)
+        return MMU_ERR_NOMAP;
+
+    *framePtr = maps[t][page].frame;
+    *protPtr = maps[t][page].prot;
+    return MMU_OK;
+}
+
+int
+MMU_GetCause(void)
+{
+    return cause;
+}
+
+int
+MMU_SetAccess(int frame, int access)
+{
+    if (!initialized)
+        return MMU_ERR_OFF;
+    if ((frame < 0) || (frame >= num_frames))
+        return MMU_ERR_FRAME;
+    if (access & ~(MMU_REF | MMU_DIRTY))
+        return MMU_ERR_ACC;
+
+    access_bits[frame] = access;
+    reinstall_frame(frame);
+    return MMU_OK;
+}
+
+int
+MMU_GetAccess(int frame, int *accessPtr)
+{
+    if (!initialized)
+        return MMU_ERR_OFF;
+    if ((frame < 0) || (frame >= num_frames))
+        return MMU_ERR_FRAME;
+
+    *accessPtr = access_bits[frame];
+    return MMU_OK;
+}
+
+int
+MMU_SetTag(int t)
+{
+    int page;
+
+    if (!initialized)
+        return MMU_ERR_OFF;
+    if ((t < 0) || (t >= MMU_NUM_TAG))
+        return MMU_ERR_TAG;
+
+    if (t != tag)
+    {
+        tag = t;
+        for (page = 0; page < num_pages; ++page)
+            install(page);
+    }
+    return MMU_OK;
+}
+
+int
+MMU_GetTag(int *tagPtr)
+{
+    if (!initialized)
+        return MMU_ERR_OFF;
+
+    *tagPtr = tag;
+    return MMU_OK;
+}
+
+int
+MMU_PageSize(void)
+{
+    return sysconf(_SC_PAGESIZE);
+}
+
+int
+MMU_Touch(void *addr)
+{
+    if (!initialized)
+        return MMU_ERR_OFF;
+
+    (void)*(volatile char *)addr;
+    return MMU_OK;
+}
@@ -0,0 +1,34 @@
+#ifndef SIM_H
+#define SIM_H
+
+/* How often the host timer looks for device events, in host us */
+#define SIM_POLL_US 1000
+
+/* Disk timing, in simulated us */
+#define DISK_OP_US      500     /* any request */
+#define DISK_TRACK_US   100     /* per track of seek distance */
+
+/* A terminal moves a character each way this often, in simulated us */
+#define TERM_CHAR_US    1000
+
+/* How many tracks a disk file gets if it doesn't exist yet: the units
+ * get 16, 32, ... */
+#define DISK_DEFAULT_TRACKS(unit) (16 * ((unit) + 1))
+
+#define NO_EVENT 0x7fffffff
+
+/* Host stack each context runs on, whatever size the kernel asked for:
+ * interrupts are handled on it, inside a 64-bit signal frame */
+#define SIM_STACK_BYTES (8 * USLOSS_MIN_STACK)
+
+extern unsigned int sim_psr;
+
+/* machine.c */
+void sim_interrupt(int dev, int unit);
+
+/* devices.c */
+void sim_devices_init(void);
+int  sim_next_due(int now, int *dev, int *unit);
+int  sim_next_event(void);
+
+#endif  /* SIM_H */